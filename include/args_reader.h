@@ -8,9 +8,34 @@
 #ifndef ARGS_READER_H
 #define ARGS_READER_H
 #include <stdbool.h>
+#include "prefetcher.h"
+#include "victim_cache.h"
+#include "tlb.h"
+#include "trace_mux.h"
+#include "coherence.h"
+#include "regions.h"
+#include "timing.h"
+#include "tenants.h"
 
 #define OPT_STR "hvs:b:E:t:"
-#define USAGE_STR "Usage: ./csim-ref [-hv] -s <s> -E <E> -b <b> -t <tracefile>"
+#define USAGE_STR "Usage: ./csim-ref [-hv] -s <s> -E <E> -b <b> -t <tracefile>"\
+                  " [options]"
+
+/* Values returned by getopt_long for options that only have a long form. */
+enum {
+    OPT_PREFETCH = 256, OPT_PREFETCH_DEGREE, OPT_PREFETCH_LATENCY,
+    OPT_VICTIM_CACHE, OPT_MISS_CACHE, OPT_POLICY, OPT_TLB, OPT_PAGE_SIZE,
+    OPT_WALK_LATENCY, OPT_SETS, OPT_INDEX, OPT_CORES, OPT_COHERENCE,
+    OPT_SHARED_CACHE, OPT_QUANTUM, OPT_CHECKPOINT_OUT, OPT_CHECKPOINT_AT,
+    OPT_RESTORE, OPT_WARMUP, OPT_ROI, OPT_ROI_MARKERS, OPT_TIMING,
+    OPT_HIT_LATENCY, OPT_MEMORY_LATENCY, OPT_MSHRS, OPT_BANDWIDTH, OPT_INTERVAL,
+    OPT_EVENT_LOG, OPT_REDUCE, OPT_REDUCE_OUT, OPT_BATCH,
+    OPT_BATCH_OUT, OPT_JOBS, OPT_BUILD_INDEX, OPT_START_AT, OPT_MAX_RECORDS,
+    OPT_PARSE_THREADS, OPT_MEMORY_REPORT, OPT_TENANTS, OPT_WAY_MASK,
+    OPT_SCHEDULE, OPT_CONFLICTS, OPT_HEATMAP, OPT_HEATMAP_REGION,
+    OPT_SYMBOLS, OPT_HEATMAP_TOP, OPT_PHASES, OPT_PHASE_CLUSTERS,
+    OPT_SIMPOINTS_OUT, OPT_SIMPOINTS, OPT_SIMPOINT_WARMUP, OPT_SECTORS
+};
 
 /* 
  * A data structure to store the args passed in on the command line.
@@ -18,14 +43,120 @@
  *  b - the number of bits used for the block offest in the cache simulator
  *  E - the number of lines in a set in the cache simulator
  *  verbose - should the program print verbose output
- *  ref_filename - the path to the valgrind reference input file
+ *  ref_filename - the path to the valgrind reference input file, - for stdin
+ *  trace_files - every trace given with -t, ref_filename is the first
+ *  prefetch - the prefetcher to attach to the cache, if any
+ *  prefetch_degree - the number of blocks a prefetcher fetches ahead
+ *  prefetch_latency - the number of accesses before a prefetch arrives
+ *  victim_entries - the size of the victim or miss cache, 0 for none
+ *  victim - whether victim_entries describes a victim or a miss cache
+ *  policy - the replacement policy of the cache
+ *  tlb_levels - the levels of the TLB to simulate, if any
+ *  page_bits - log2 of the page size used by the TLB
+ *  walk_latency - the cost of each page table reference of a page walk
+ *  num_sets - the number of cache sets, overrides s when it is not 0
+ *  index_fn - how the set of an address is chosen
+ *  cores - the number of cores to simulate, 1 for a single cache
+ *  protocol - the coherence protocol between the cores
+ *  shared_s, shared_E - the shape of the cache shared by the cores, if any
+ *  quantum - the accesses each trace contributes per turn when interleaving
+ *  checkpoint_out - where to save a checkpoint of the cache, if anywhere
+ *  checkpoint_at - the trace records to simulate before saving, -1 for all
+ *  restore_filename - a checkpoint to start from instead of a cold cache
+ *  regions - the warmup and regions of interest to restrict counting to
+ *  timing - whether to estimate the run time of the trace
+ *  timing_config - the latencies and limits the estimate uses
+ *  interval - the records between interval statistics, 0 for none
+ *  event_log - where to write the binary per access log, if anywhere
+ *  reduce - whether to fold runs of accesses to the same block
+ *  reduce_out - where to write the reduced trace, if anywhere
+ *  batch_filename - a manifest of jobs to run instead of a single trace
+ *  batch_out - where to write the results of the jobs, stdout if NULL
+ *  jobs - the number of threads running the jobs
+ *  build_index - the stride of a trace index to build, 0 for none
+ *  start_at - the trace record to start simulating at
+ *  max_records - the most trace records to simulate, -1 for all
+ *  parse_threads - the threads parsing the trace up front, 0 for none
+ *  memory_report - whether to print the memory the cache lines take
+ *  tenants - whether the streams of the cache are tenants to account for
+ *  way_masks - the ways each tenant may fill, 0 for every way
+ *  schedule - the quantum of each trace when interleaving, if given
+ *  conflict_bits - log2 of the regions conflicts are analyzed in, 0 for no
+ *                  analysis
+ *  heatmap - whether to count accesses per set and region
+ *  heatmap_out - where to write the heatmap, if anywhere
+ *  heatmap_bits - log2 of the size of the heatmap's regions
+ *  symbols_file - named address ranges to use as regions, if any
+ *  heatmap_top - the sets and regions with the most misses to print
+ *  phase_interval - the records per interval when profiling phases, 0 for
+ *                   no profile
+ *  phase_clusters - the most simpoints the profile picks
+ *  simpoints_out - where to save the simpoints picked, if anywhere
+ *  simpoints_file - simpoints to simulate instead of the whole trace
+ *  simpoint_warmup - the records simulated before each simpoint, -1 for
+ *                    one interval
+ *  sectors - the sectors each block is split into, 0 for a block cache
  */
 typedef struct {
     int s, b, E;
     bool verbose;
     char* ref_filename;
+    char* trace_files[MAX_TRACES];
+    int num_traces;
+    prefetch_kind prefetch;
+    int prefetch_degree, prefetch_latency;
+    int victim_entries;
+    victim_kind victim;
+    replacement_policy policy;
+    tlb_level_config tlb_levels[MAX_TLB_LEVELS];
+    int num_tlb_levels;
+    int page_bits, walk_latency;
+    int num_sets;
+    index_function index_fn;
+    /* Whether --policy and --index were given, a restore checks them. */
+    bool policy_given, index_given;
+    int cores;
+    coherence_protocol protocol;
+    int shared_s, shared_E;
+    int quantum;
+    char* checkpoint_out;
+    long checkpoint_at;
+    char* restore_filename;
+    region_config regions;
+    bool timing;
+    timing_config timing_config;
+    long interval;
+    char* event_log;
+    bool reduce;
+    char* reduce_out;
+    char* batch_filename;
+    char* batch_out;
+    int jobs;
+    int build_index;
+    long start_at, max_records;
+    int parse_threads;
+    bool memory_report;
+    bool tenants;
+    uint64_t way_masks[MAX_TENANTS];
+    int schedule[MAX_TRACES];
+    int num_schedule;
+    int conflict_bits;
+    bool heatmap;
+    char* heatmap_out;
+    int heatmap_bits;
+    char* symbols_file;
+    int heatmap_top;
+    long phase_interval;
+    int phase_clusters;
+    char* simpoints_out;
+    char* simpoints_file;
+    long simpoint_warmup;
+    int sectors;
 } program_args;
 
+/* fill ARGS with the default value of every option */
+void init_args(program_args* args);
+
 /* populate the fileds in ARGS with values from the command line */
 int get_args(program_args* args, int argc, char** argv);
 
@@ -0,0 +1,74 @@
+/*
+ * batch.h
+ *
+ * Batch mode runs many simulations in one process. A manifest lists one
+ * job per line, written as the csim arguments for that run (blank lines
+ * and lines starting with # are skipped):
+ *
+ *     -s 5 -E 1 -b 5 -t traces/long.trace
+ *     -s 5 -E 1 -b 5 -t traces/long.trace --policy fifo --timing
+ *
+ * Every job is parsed up front, the jobs are shared out to a pool of
+ * threads, and the totals of all of them are written to a single CSV or
+ * JSON file. Jobs must use a single cache and read their trace from a
+ * file; verbose output and interval statistics are turned off.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+#include "args_reader.h"
+#include <stdbool.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+/* The most arguments a job may have, and the most threads to run them. */
+#define MAX_BATCH_ARGS 64
+#define MAX_BATCH_THREADS 64
+
+typedef struct {
+    /* The manifest line, cut up in place into argv. */
+    char* line;
+    char* argv[MAX_BATCH_ARGS];
+    int argc;
+    /* The job's arguments as written, for the results file. */
+    char* text;
+    program_args args;
+    /* Whether the job ran to completion. */
+    bool done;
+    int hits, misses, evictions;
+    long records;
+    /* The timing model estimate, when the job asked for one. */
+    bool timed;
+    uint64_t cycles;
+    double amat;
+    /* The wall clock time the job took. */
+    double seconds;
+} batch_job;
+
+typedef struct {
+    batch_job* jobs;
+    int num_jobs, capacity;
+    /* The next job for a worker to take. */
+    int next_job;
+    pthread_mutex_t lock;
+} batch;
+
+/*
+ * Read and parse every job in the manifest at path. Returns NULL (after
+ * reporting which line was bad) on error.
+ */
+batch* read_batch_manifest(const char* path);
+
+/* Free the batch. */
+void destroy_batch(batch* b);
+
+/* Run every job using the given number of threads. */
+void run_batch(batch* b, int threads);
+
+/*
+ * Write the results of every job to path, as JSON if it ends in .json and
+ * as CSV otherwise, or as CSV to standard output if path is NULL. Returns
+ * false if the file could not be written.
+ */
+bool write_batch_results(batch* b, const char* path);
+
+#endif
@@ -8,6 +8,9 @@
  * function, which returns the simulator. The simulator tracks the number
  * of cache hits, cache misses, and cache evictions for a given set of instructions
  * which are given to the simulator via the check_cache function.
+ *
+ * Optional models (a prefetcher, a victim cache) can be attached to a
+ * simulator, check_cache notifies them of every access.
  * 
  * Author: Josh Leath
  * Last updated: 6/4/17
@@ -22,31 +25,115 @@
 #define CACHE_SIMULATOR_H
 #include <stdbool.h>
 #include <inttypes.h>
+#include <stddef.h>
 
 typedef enum { CACHE_HIT, CACHE_EVICTION, CACHE_MISS } op_state;
 
 /*
- * A simple type for a single line in a cache set
+ * How a line is chosen for replacement.
+ *  LRU - the line used least recently.
+ *  FIFO - the line filled least recently.
+ *  RANDOM - any line, chosen uniformly.
+ *  OPT - the line whose block is next used furthest in the future
+ *        (Belady's MIN), told to the cache through next_use.
+ *  SRRIP - static re-reference interval prediction: lines are filled
+ *          expecting a long re-reference interval and replaced once they
+ *          reach a distant one.
+ *  DIP - LRU, with set dueling between inserting at the MRU position and
+ *        bimodal insertion (BIP), mostly at the LRU position.
+ *  DRRIP - RRIP, with set dueling between SRRIP and bimodal insertion
+ *          (BRRIP), mostly at a distant interval.
  */
-typedef struct {
-    /* The tag of the block stored in this line */
-    unsigned tag;
+typedef enum {
+    REPLACE_LRU, REPLACE_FIFO, REPLACE_RANDOM, REPLACE_OPT, REPLACE_SRRIP,
+    REPLACE_DIP, REPLACE_DRRIP
+} replacement_policy;
+
+/*
+ * How the set of a block is chosen from its block address.
+ *  BIT_SLICE - the low bits of the block address, needs a power of two
+ *              number of sets.
+ *  MODULO - the block address modulo the number of sets.
+ *  XOR - the block address folded onto itself with XOR.
+ *  PRIME - the block address modulo the largest prime not above the
+ *          number of sets, the remaining sets are unused.
+ *  SKEWED - each way hashes the block address differently, so blocks that
+ *           conflict in one way are usually apart in the others.
+ */
+typedef enum {
+    INDEX_BIT_SLICE, INDEX_MODULO, INDEX_XOR, INDEX_PRIME, INDEX_SKEWED
+} index_function;
+
+struct prefetcher;
+struct victim_cache;
+struct tenant_table;
+struct sector_map;
+struct dueling;
+
+/*
+ * The bits of a line's tag that are kept. Block addresses of 48 bit
+ * virtual addresses fit at any block size (57 bit ones with blocks of 32
+ * bytes or more); get_address_info drops any bits above these.
+ */
+#define LINE_TAG_BITS 52
+#define LINE_TAG_MASK ((1ULL << LINE_TAG_BITS) - 1)
+
+/*
+ * The re-reference prediction values of RRIP: a line re-referenced soon,
+ * one filled expecting a long interval, and one to be replaced next.
+ */
+#define RRPV_NEAR 0
+#define RRPV_LONG 2
+#define RRPV_DISTANT 3
+
+/* The most set index bits a cache can have, sets are counted in an int. */
+#define MAX_SET_BITS 30
+
+/* The size to aim for when allocating a page of cache sets. */
+#define SET_PAGE_BYTES 4096
+
+/*
+ * A simple type for a single line in a cache set, packed into 12 bytes.
+ */
+typedef struct __attribute__((packed, aligned(4))) {
+    /*
+     * The tag of the block stored in this line. Unless the cache uses
+     * bit slice indexing this is the whole block address.
+     */
+    uint64_t tag : LINE_TAG_BITS;
     /* A flag indicating whether the block in this line is meaningful */
-    bool valid_bit;
+    uint64_t valid_bit : 1;
+    /* Set if the block was brought in by a prefetch and not yet used. */
+    uint64_t prefetched : 1;
+    /* The coherence state of the block, used by the multi-core model. */
+    uint64_t state : 3;
+    /* The tenant that filled the line, when tenants share the cache. */
+    uint64_t owner : 4;
+    /* The re-reference prediction value of the line under RRIP. */
+    uint64_t rrpv : 2;
     /* 
      * The number of the last instruction to touch this line. Used
-     * for the LRU strategy of dealing with cache evictions.
+     * for the LRU strategy of dealing with cache evictions. Under
+     * FIFO it is the instruction that filled the line, and under OPT the
+     * access that next uses its block.
      */
     int last_instruction;
 } line;
 
 /*
- * A type for the simulator. Contains an array of line objects
- * and various information about the state of the cache.
+ * A type for the simulator. Contains the cache lines and various
+ * information about the state of the cache. The lines are kept in pages
+ * of whole sets which are only allocated once a block is placed in one of
+ * their sets, so a large cache only costs memory for the sets a trace
+ * actually uses.
  */
 typedef struct {
-    /* The lines in the cache. */
-    line* lines;
+    /* The pages of lines, NULL until first filled. */
+    line** pages;
+    /* The number of pages, log2 of the sets in each, and the lines in each. */
+    int num_pages, page_bits, page_lines;
+    /* The number of pages allocated so far. */
+    int pages_allocated;
     /* The number of lines in each cache set. */
     int lines_per_set;
     /* various data about the performance of the cache. */
@@ -54,14 +141,44 @@ typedef struct {
     /* Information about how to partition addresses. */
     int tag_len, offset_len, index_len;
     /* The total number of lines in the cache. */
-    int num_lines;
+    size_t num_lines;
+    /* The number of sets, and how a block's set is chosen. */
+    int num_sets;
+    index_function index_fn;
+    /* The divisor used by MODULO and PRIME indexing. */
+    int set_modulus;
+    /* How lines are replaced, and the random state for REPLACE_RANDOM. */
+    replacement_policy policy;
+    uint64_t rng_state;
+    /*
+     * Under OPT, the index of the next access to the block being checked.
+     * The lines of each set are kept as a max-heap on their next use, so
+     * the line to replace is always the first.
+     */
+    int next_use;
+    /* An optional prefetcher, NULL if the cache only sees demand accesses. */
+    struct prefetcher* prefetcher;
+    /* An optional victim or miss cache, NULL if there is none. */
+    struct victim_cache* victim_cache;
+    /* The tenants sharing the cache, NULL if it is not partitioned. */
+    struct tenant_table* tenants;
+    /* The sectors of every line, NULL if blocks are not sectored. */
+    struct sector_map* sectors;
+    /* Whether the access being checked writes, for dirty sectors. */
+    bool writing;
+    /* The set dueling of DIP and DRRIP, NULL under other policies. */
+    struct dueling* dueling;
+    /* The line replaced by the last demand eviction, and its block address. */
+    line last_victim;
+    uint64_t last_victim_block;
 } cache_simulator;
 
 /*
  * A type to store the partitions of an address
  */
 typedef struct {
-    unsigned tag, set_index, offset;
+    uint64_t tag;
+    unsigned set_index, offset;
 } address_info;
 
 /*
@@ -69,9 +186,41 @@ typedef struct {
  * b - the number of bits used to store the block offset.
  * s - the number of bits used to store the set index.
  * E - the number of lines per cache set.
+ * Returns NULL if s is above MAX_SET_BITS or the memory could not be
+ * allocated.
  */
 cache_simulator* build_simulator(int b, int s, int E);
 
+/*
+ * Construct and return a cache simulator with any number of sets.
+ * b - the number of bits used to store the block offset.
+ * num_sets - the number of cache sets.
+ * E - the number of lines per cache set.
+ * index_fn - how sets are chosen, BIT_SLICE needs a power of two num_sets.
+ * Returns NULL if there are more than 2^MAX_SET_BITS sets, or the memory
+ * could not be allocated.
+ */
+cache_simulator* build_indexed_simulator(int b, int num_sets, int E,
+                                         index_function index_fn);
+
+/*
+ * Parse the name of an index function ("slice", "mod", "xor", "prime" or
+ * "skew"). Returns false if the name is not recognised.
+ */
+bool parse_index_function(const char* name, index_function* index_fn);
+
+/*
+ * Parse the name of a replacement policy ("lru", "fifo", "random", "opt",
+ * "srrip", "dip" or "drrip"). Returns false if the name is not recognised.
+ */
+bool parse_replacement_policy(const char* name, replacement_policy* policy);
+
+/*
+ * Make policy the replacement policy of cache, setting up the dueling of
+ * DIP and DRRIP. Returns false if memory ran out.
+ */
+bool set_replacement_policy(cache_simulator* cache, replacement_policy policy);
+
 /*
  * checks if the block containing the memory represented by addr is in the cache
  * updates the internal state of the cache based on the check. Returns an op_state
@@ -80,7 +229,42 @@ cache_simulator* build_simulator(int b, int s, int E);
 op_state check_cache(cache_simulator* cache, address_info* addr, int inst_no);
 
 /*
- * Free the resources used to construct the cache simulator.
+ * Bring the block with the given block address into the cache without
+ * counting a demand access. Returns false if the block was already cached.
+ * If a valid line had to be replaced its block address is stored in victim,
+ * otherwise victim is left untouched.
+ */
+bool prefetch_fill(cache_simulator* cache, uint64_t block, int inst_no,
+                   uint64_t* victim);
+
+/*
+ * Returns true if the block with the given block address is in the cache.
+ * Does not update any replacement state.
+ */
+bool contains_block(cache_simulator* cache, uint64_t block);
+
+/*
+ * Return the valid line holding the block with the given block address,
+ * or NULL if it is not cached. Does not update any replacement state.
+ */
+line* find_block(cache_simulator* cache, uint64_t block);
+
+/*
+ * Update the replacement state of the block in addr, left in the cache by
+ * the last access, as a hit at inst_no would, without counting the hit.
+ * For the accesses a reduced trace folded into the last one.
+ */
+void touch_block(cache_simulator* cache, address_info* addr, int inst_no);
+
+/*
+ * Remove the block with the given block address from the cache. Returns
+ * false if it was not cached.
+ */
+bool invalidate_block(cache_simulator* cache, uint64_t block);
+
+/*
+ * Free the resources used to construct the cache simulator, including
+ * any attached models.
  */
 void destroy_simulator(cache_simulator* cache);
 
@@ -90,4 +274,24 @@ void destroy_simulator(cache_simulator* cache);
 void get_address_info(uint64_t address, address_info* addr,
         cache_simulator* cache);
 
+/*
+ * Return the block address (the address without its offset bits) of a
+ * partitioned address.
+ */
+uint64_t get_block_address(cache_simulator* cache, address_info* addr);
+
+/*
+ * Return the lines of a page of sets, allocating the page first if create
+ * is set and it has not been. Returns NULL for a page never allocated when
+ * create is not set.
+ */
+line* get_page(cache_simulator* cache, int page, bool create);
+
+/*
+ * Print the memory the lines and the table of pages take now, the memory
+ * every line would take in one dense array, and the peak resident size of
+ * the process.
+ */
+void print_memory_summary(cache_simulator* cache);
+
 #endif
@@ -0,0 +1,67 @@
+/*
+ * checkpoint.h
+ *
+ * Saving a cache_simulator to a file and restoring it, so a cache warmed
+ * on a long trace prefix can be reused by many runs. A checkpoint is a
+ * versioned header followed by every allocated page of lines, each after
+ * its page number, and is restored by mapping the file and copying the
+ * pages straight into a new simulator. The set dueling of DIP and DRRIP is
+ * part of the replacement state, so its counters are kept in the header
+ * and the runs of its timeline follow the pages.
+ *
+ * Only the cache itself is saved: attached models (prefetchers, victim
+ * caches) start empty after a restore.
+ */
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include "cache_simulator.h"
+#include <stdbool.h>
+#include <inttypes.h>
+
+#define CHECKPOINT_MAGIC "CSIMCKPT"
+#define CHECKPOINT_VERSION 3
+
+/* Where in the trace a checkpoint was taken. */
+typedef struct {
+    /* The byte offset of the next trace record. */
+    int64_t trace_offset;
+    /* The number of the next instruction. */
+    int64_t inst_no;
+    /* The number of trace records already simulated. */
+    int64_t records;
+} trace_position;
+
+/* The fixed size header at the start of a checkpoint file. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    /* sizeof(line) when written, the line array is not portable */
+    uint32_t line_size;
+    int32_t offset_len, num_sets, lines_per_set, index_fn, policy;
+    int32_t hit_count, miss_count, eviction_count;
+    uint64_t rng_state;
+    trace_position position;
+    /* the lines in each page, and the pages that follow the header */
+    int32_t page_lines;
+    int64_t saved_pages;
+    /* the set dueling, if any, and the runs that follow the pages */
+    int32_t psel, dueling_runs;
+    int64_t dueling_accesses;
+    uint64_t leader_misses[2], follower_fills[2];
+} checkpoint_header;
+
+/*
+ * Write the state of cache and the trace position to path. Returns false
+ * if the file could not be written.
+ */
+bool save_checkpoint(cache_simulator* cache, trace_position* position,
+                     const char* path);
+
+/*
+ * Build a cache simulator from the checkpoint at path and store the trace
+ * position it was taken at. Returns NULL (after reporting why) if the file
+ * is missing, is not a checkpoint of this version, or memory ran out.
+ */
+cache_simulator* load_checkpoint(const char* path, trace_position* position);
+
+#endif
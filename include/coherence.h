@@ -0,0 +1,85 @@
+/*
+ * coherence.h
+ *
+ * A multi-core model. Each core has a private cache_simulator, kept
+ * coherent with a snooping MESI or MOESI protocol, and the cores may share
+ * a further cache level that serves the private misses no other core can.
+ *
+ * Loads read a block and stores (and modifies) write it. A write needs the
+ * only copy of a block, so the copies in other cores are invalidated. A
+ * miss is served by another core's copy (a cache-to-cache transfer) when
+ * that core holds it Modified, Exclusive or, under MOESI, Owned.
+ */
+#ifndef COHERENCE_H
+#define COHERENCE_H
+#include "cache_simulator.h"
+#include <stdbool.h>
+#include <inttypes.h>
+
+/* The most cores the model supports. */
+#define MAX_CORES 16
+/* The number of blocks each core remembers losing to invalidations. */
+#define INVALIDATION_FILTER 4096
+
+typedef enum {
+    STATE_INVALID = 0, STATE_SHARED, STATE_EXCLUSIVE, STATE_OWNED,
+    STATE_MODIFIED
+} coherence_state;
+
+typedef enum { PROTOCOL_MESI, PROTOCOL_MOESI } coherence_protocol;
+
+/* The coherence activity of a single core. */
+typedef struct {
+    /* Misses on a block this core lost to another core's write. */
+    unsigned long coherence_misses;
+    /* Writes to a Shared or Owned block, which must invalidate the others. */
+    unsigned long upgrades;
+    /* Invalidations this core caused in others, and received from them. */
+    unsigned long invalidations_sent, invalidations_received;
+    /* Blocks this core supplied to others, and received from them. */
+    unsigned long transfers_sent, transfers_received;
+    /* Dirty blocks written back on eviction or downgrade. */
+    unsigned long writebacks;
+} core_stats;
+
+typedef struct {
+    coherence_protocol protocol;
+    int num_cores;
+    cache_simulator* cores[MAX_CORES];
+    core_stats stats[MAX_CORES];
+    /* An optional level shared by every core, NULL if there is none. */
+    cache_simulator* shared;
+    /* Per core, the blocks lost to invalidations (plus one, 0 is empty). */
+    uint64_t* invalidated[MAX_CORES];
+} coherent_system;
+
+/*
+ * Construct num_cores private caches with the given geometry. If
+ * shared_s is positive the cores also share a cache with 2^shared_s sets
+ * of shared_E lines and the same block size. Returns NULL if the memory
+ * could not be allocated.
+ */
+coherent_system* build_coherent_system(int num_cores, int b, int s, int E,
+                                       int shared_s, int shared_E,
+                                       coherence_protocol protocol);
+
+/* Free every cache of the system. */
+void destroy_coherent_system(coherent_system* sys);
+
+/*
+ * Parse the name of a protocol ("mesi" or "moesi"). Returns false if the
+ * name is not recognised.
+ */
+bool parse_coherence_protocol(const char* name, coherence_protocol* protocol);
+
+/*
+ * Perform a read or write of address by a core. Returns the result of the
+ * access in the core's private cache.
+ */
+op_state coherent_access(coherent_system* sys, int core, uint64_t address,
+                         bool write, int inst_no);
+
+/* Print the per core and shared cache statistics. */
+void print_coherence_summary(coherent_system* sys);
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * conflicts.h
+ *
+ * Conflict hot spot analysis. Every eviction of a block by a demand miss
+ * is recorded as a pair of address regions, the region of the block that
+ * missed and the region of its victim, along with the distance between the
+ * two blocks and the sets they met in. At the end of a run the regions
+ * involved are clustered into arrays (runs of neighbouring regions), the
+ * pairs are folded into conflicts between two arrays, or within one, and
+ * the worst conflicts are given a padding fix: shifting the second array
+ * by some blocks, or padding an array every stride bytes (the common
+ * distance of its conflicting blocks). Each fix is verified by simulating
+ * the records of the run again with their addresses moved, on a cold,
+ * plain cache of the same shape and policy, and the best fix of each
+ * conflict is reported with the misses it saves. So that the baseline is
+ * the run itself, the run must be on a plain cache too: no prefetcher,
+ * sectors, tenants, or victim or miss cache.
+ */
+#ifndef CONFLICTS_H
+#define CONFLICTS_H
+#include "cache_simulator.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <inttypes.h>
+
+/* The conflicts given a fix, and the paddings tried for each. */
+#define MAX_CONFLICT_FIXES 5
+#define MAX_PADDINGS 16
+
+/* Evictions between two regions, first <= second. */
+typedef struct {
+    uint64_t first, second;
+    long evictions;
+    /* The gcd of the distances in bytes between the blocks. */
+    uint64_t distance;
+    /* The sets the evictions happened in, by set index mod 64. */
+    uint64_t sets;
+} conflict_pair;
+
+/* A conflict between two arrays of regions, or within one. */
+typedef struct {
+    /* The byte ranges [lo, hi) of the two arrays. */
+    uint64_t first_lo, first_hi, second_lo, second_hi;
+    long evictions;
+    uint64_t distance, sets;
+    /* The best fix found: pad bytes, every stride bytes if not 0. */
+    uint64_t pad, stride;
+    /* The misses of the trace with the fix, -1 if none was tried. */
+    long misses;
+} conflict;
+
+typedef struct {
+    int region_bits;
+    /* An open addressing map of the pairs seen, evictions 0 when empty. */
+    conflict_pair* pairs;
+    size_t capacity, size;
+    long evictions;
+    /* The ranked conflicts and the misses of the unchanged trace. */
+    conflict* conflicts;
+    int num_conflicts, num_arrays;
+    long baseline_misses;
+    /* The records of the trace the run simulated, all if max_records < 0. */
+    long first_record, max_records;
+} conflict_analyzer;
+
+/*
+ * Construct an analyzer of regions of 2^region_bits bytes. Returns NULL
+ * if memory ran out.
+ */
+conflict_analyzer* build_conflict_analyzer(int region_bits);
+
+/* Free the analyzer. */
+void destroy_conflict_analyzer(conflict_analyzer* ca);
+
+/*
+ * Record that the block at address evicted the block at victim (both in
+ * bytes) from set. Returns false if memory ran out.
+ */
+bool conflict_record(conflict_analyzer* ca, uint64_t address,
+                     uint64_t victim, int set);
+
+/*
+ * Cluster the pairs into conflicts, rank them, and find a fix for the worst
+ * by simulating the records of the trace in filename the run simulated,
+ * max_records of them from first_record (all if max_records < 0), again
+ * on a cache shaped like cache. Returns false (after reporting why) if the
+ * trace could not be read or memory ran out.
+ */
+bool analyze_conflicts(conflict_analyzer* ca, cache_simulator* cache,
+                       const char* filename, long first_record,
+                       long max_records);
+
+/* Print the ranked conflicts and the fixes found. */
+void print_conflict_report(conflict_analyzer* ca);
+
+#endif
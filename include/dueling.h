@@ -0,0 +1,71 @@
+/*
+ * dueling.h
+ *
+ * Set dueling for adaptive insertion (DIP and DRRIP). A few leader sets
+ * always insert with the first policy (LRU or SRRIP insertion) and as many
+ * always insert with the second (bimodal: BIP or BRRIP). A miss in a
+ * leader set of the first policy counts a saturating policy selector up,
+ * one in a leader of the second counts it down, and every other set (the
+ * followers) inserts with whichever policy the selector says misses less.
+ *
+ * The winner is sampled every DUELING_EPOCH accesses, and the runs of
+ * epochs each policy won are reported at the end.
+ */
+#ifndef DUELING_H
+#define DUELING_H
+#include <stdbool.h>
+#include <inttypes.h>
+
+/* The leader sets of each policy, at most, and the selector's bits. */
+#define DUELING_LEADERS 32
+#define PSEL_BITS 10
+
+/* The fewest sets with a leader of each policy and a follower. */
+#define DUELING_MIN_SETS 3
+
+/* The accesses between samples of the winning policy. */
+#define DUELING_EPOCH 10000
+
+/* A run of epochs won by the same policy. */
+typedef struct {
+    int policy;
+    long epochs;
+} dueling_run;
+
+typedef struct dueling {
+    /* The names of the two policies. */
+    const char* names[2];
+    /* The sets between leaders of the same policy, 0 if there are none. */
+    int stride;
+    int leaders;
+    int psel;
+    /* Demand misses in each policy's leaders, fills of the followers. */
+    unsigned long leader_misses[2], follower_fills[2];
+    long accesses;
+    /* The runs of epochs each policy won, in order. */
+    dueling_run* runs;
+    int num_runs, runs_capacity;
+} dueling;
+
+/*
+ * Construct the dueling of two insertion policies, named first and second,
+ * over a cache of num_sets sets. Returns NULL if memory ran out.
+ */
+dueling* build_dueling(int num_sets, const char* first, const char* second);
+
+/* Free the dueling. */
+void destroy_dueling(dueling* d);
+
+/* Return the policy, 0 or 1, that set inserts with. */
+int dueling_choice(dueling* d, int set);
+
+/* Count an access, sampling the winner at the end of each epoch. */
+void dueling_access(dueling* d);
+
+/* Count a demand miss in set, steering the selector if it is a leader. */
+void dueling_miss(dueling* d, int set);
+
+/* Print the selector, the leader misses and the runs each policy won. */
+void print_dueling_summary(dueling* d);
+
+#endif
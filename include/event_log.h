@@ -0,0 +1,84 @@
+/*
+ * event_log.h
+ *
+ * Fast logging of the outcome of every access. The text log writes the
+ * same lines as the verbose output, but formats them by hand into a large
+ * output buffer instead of making several printf calls per access. The
+ * binary log writes one fixed size record per trace record after a header,
+ * so other tools can map the file and index it directly.
+ */
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+#include "cache_simulator.h"
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+#define EVENT_LOG_MAGIC "CSIMEVTS"
+#define EVENT_LOG_VERSION 1
+
+/* The size of the text output buffer and of the binary record buffer. */
+#define TEXT_LOG_BUFFER (1 << 20)
+#define EVENT_LOG_BUFFER 4096
+
+/* The fixed size header at the start of a binary log. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    /* sizeof(event_record) */
+    uint32_t record_size;
+    uint64_t num_records;
+    /* the shape of the cache, to turn set and tag back into an address */
+    int32_t offset_len, num_sets, lines_per_set, index_fn;
+} event_log_header;
+
+/* The outcome of one trace record. */
+typedef struct {
+    /* The index of the record in the trace. */
+    uint64_t index;
+    /* The tag of the line evicted, when outcome is CACHE_EVICTION. */
+    uint64_t evicted_tag;
+    uint32_t set;
+    /* an op_state, the write half of a modify always hits */
+    uint8_t outcome;
+    /* the trace op, L, S or M */
+    char op;
+    uint16_t reserved;
+} event_record;
+
+typedef struct {
+    FILE* file;
+    event_record records[EVENT_LOG_BUFFER];
+    int buffered;
+    uint64_t num_records;
+    /* set if a buffer of records could not be written */
+    bool failed;
+} event_log;
+
+/* Give standard output a buffer large enough for the text log. */
+void start_text_log(void);
+
+/*
+ * Write a verbose line for an access, prefixed by its core if core is not
+ * negative. The second result is only written for a modify.
+ */
+void log_text_access(int core, char op, uint64_t address, unsigned size,
+                     op_state result);
+
+/*
+ * Create a binary log at path for accesses to cache. Returns NULL (after
+ * reporting why) if the file could not be created or memory ran out.
+ */
+event_log* open_event_log(const char* path, cache_simulator* cache);
+
+/* Append the outcome of a trace record. */
+void log_event(event_log* log, uint64_t index, char op, unsigned set,
+               op_state result, uint64_t evicted_tag);
+
+/*
+ * Write out the buffered records and the final header and free the log.
+ * Returns false if the file could not be written.
+ */
+bool close_event_log(event_log* log);
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * heatmap.h
+ *
+ * Where in the cache and in memory the misses happen. The accesses,
+ * misses and evictions of the run are added up per set and per region of
+ * memory, either fixed size regions such as 4K pages or the named address
+ * ranges of a symbol file (with one more region for everything else).
+ * Evictions are counted for the region whose miss caused them, and
+ * evicted for the region that lost the block. The counters are flat, and
+ * the map of regions only allocates when it grows, so the heatmap is cheap
+ * enough to leave on for whole traces.
+ *
+ * The counters can be written out as CSV, or JSON, and the sets and
+ * regions with the most misses printed after the summary.
+ *
+ * A symbol file has one range per line, "name start end" with the addresses
+ * in hex and end exclusive; blank lines and lines starting with # are
+ * skipped.
+ */
+#ifndef HEATMAP_H
+#define HEATMAP_H
+#include "cache_simulator.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <inttypes.h>
+
+/* The longest symbol name, and the sets and regions printed by default. */
+#define MAX_SYMBOL_NAME 64
+#define DEFAULT_HEATMAP_TOP 10
+
+typedef struct {
+    long accesses, misses, evictions, evicted;
+} heat_counts;
+
+typedef struct {
+    char name[MAX_SYMBOL_NAME];
+    uint64_t start, end;
+} symbol_range;
+
+typedef struct {
+    heat_counts* sets;
+    int num_sets;
+    int region_bits;
+    /* Fixed size regions, an open addressing map of region plus one. */
+    uint64_t* region_keys;
+    heat_counts* regions;
+    size_t capacity, size;
+    /* Named regions sorted by start, the counts have one more entry. */
+    symbol_range* symbols;
+    heat_counts* symbol_counts;
+    int num_symbols;
+} heatmap;
+
+/*
+ * Construct a heatmap of a cache with num_sets sets, with regions of
+ * 2^region_bits bytes, or the ranges of symbols_file if that is not NULL.
+ * Returns NULL (after reporting why) if the symbols could not be read or
+ * memory ran out.
+ */
+heatmap* build_heatmap(int num_sets, int region_bits,
+                       const char* symbols_file);
+
+/* Free the heatmap. */
+void destroy_heatmap(heatmap* hm);
+
+/*
+ * Count accesses to address, which mapped to set, the first of which had
+ * the given result and the rest of which hit. Returns false if memory ran
+ * out.
+ */
+bool heatmap_access(heatmap* hm, int set, uint64_t address, int accesses,
+                    op_state result);
+
+/* Count the eviction of the block at address. */
+bool heatmap_evicted(heatmap* hm, uint64_t address);
+
+/*
+ * Write every set and region with accesses to path, as JSON if it ends in
+ * .json and CSV otherwise. Returns false if the file could not be written.
+ */
+bool write_heatmap(heatmap* hm, const char* path);
+
+/* Print the top sets and regions by misses. */
+void print_heatmap_top(heatmap* hm, int top);
+
+#endif
@@ -18,12 +18,38 @@ typedef struct {
     uint64_t address;
     /* The number of bytes the operation should act on. */ 
     unsigned size;
+    /*
+     * The thread (or other stream) that made the access. Read from an
+     * optional third field, " L 04f6b868,8,1", and 0 when it is missing.
+     */
+    unsigned stream;
+    /*
+     * The number of accesses just like this one, to the same block, that
+     * directly followed it and were folded into it by trace reduction. Read
+     * from an optional fourth field, " L 04f6b868,8,0,7".
+     */
+    unsigned repeat;
 } instruction;
 
+/*
+ * Open a trace for reading, "-" reads standard input (a pipe or FIFO from
+ * valgrind works too). Returns NULL if the file could not be opened.
+ */
+FILE* open_trace(const char* filename);
+
+/* Close a trace opened with open_trace. */
+void close_trace(FILE* file);
+
+/*
+ * Write inst to file as a trace record that read_instruction reads back,
+ * leaving out the stream and repeat fields when they are not needed.
+ */
+void write_instruction(FILE* file, instruction* inst);
+
 /* 
  * Read an instruction from file and store the details in inst.
  * returns nonzero if an instruction was read successfully, else returns 0
  */ 
 int read_instruction(FILE* file, instruction* inst);
 
-#endif
\ No newline at end of file
+#endif
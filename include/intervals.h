@@ -0,0 +1,43 @@
+/*
+ * intervals.h
+ *
+ * Prints the statistics of a run as a time series, one line for every
+ * interval of a fixed number of trace records, so long or piped traces can
+ * be watched while they are simulated. Each line has the hits, misses and
+ * evictions of that interval alone along with its miss rate and the miss
+ * rate of the run so far.
+ */
+#ifndef INTERVALS_H
+#define INTERVALS_H
+#include <stdbool.h>
+
+typedef struct {
+    /* The records in each interval, 0 when intervals are off. */
+    long length;
+    /* The first record of the current interval. */
+    long first;
+    /* The running totals when the current interval began. */
+    int hits, misses, evictions;
+} interval_stats;
+
+/*
+ * Start the time series at record first, printing every length records.
+ * hits, misses and evictions are the totals so far (non zero when the run
+ * was restored from a checkpoint).
+ */
+void init_intervals(interval_stats* is, long length, long first, int hits,
+                    int misses, int evictions);
+
+/*
+ * Called after each record with the running totals of the run and the
+ * number of records seen so far. Prints a line when an interval ends (a
+ * reduced trace record may carry the interval a little past its length).
+ */
+void interval_record(interval_stats* is, long records, int hits,
+                     int misses, int evictions);
+
+/* Print the last, partial, interval if it saw any records. */
+void interval_finish(interval_stats* is, long records, int hits,
+                     int misses, int evictions);
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ * opt_oracle.h
+ *
+ * The future knowledge Belady's OPT (MIN) replacement needs. Before a run
+ * the oracle reads the rest of the trace once, writing the block address
+ * of every access to a temporary file, then walks that file backwards a
+ * chunk at a time to find when each access's block is next used. The next
+ * use distances are kept in a second temporary file and streamed back a
+ * chunk at a time during the run, so only two chunks and a map of the
+ * distinct blocks are ever in memory.
+ */
+#ifndef OPT_ORACLE_H
+#define OPT_ORACLE_H
+#include "cache_simulator.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+/* The accesses read or written at a time. */
+#define OPT_CHUNK 65536
+
+/* The next use of a block that is never used again. */
+#define OPT_NEVER (INT32_MAX - 1)
+
+typedef struct {
+    /* The next use of every access, in trace order. */
+    FILE* next_uses;
+    int32_t buffer[OPT_CHUNK];
+    int buffered, next;
+    /* The accesses the oracle knows of, and the number handed out. */
+    long accesses, served;
+} opt_oracle;
+
+/*
+ * Read the trace from the current position of file to its end, folding
+ * runs of accesses to a block if reduce is set, and work out the next use
+ * of every access to cache. file is left where it was. Returns NULL (after
+ * reporting why) if the trace could not be read or memory ran out.
+ */
+opt_oracle* build_opt_oracle(cache_simulator* cache, FILE* file,
+                             bool reduce);
+
+/* Free the oracle and its temporary files. */
+void destroy_opt_oracle(opt_oracle* oo);
+
+/*
+ * Return the index of the next access to the block of the next access,
+ * or OPT_NEVER. Accesses are numbered from 0 in trace order.
+ */
+int32_t opt_next_use(opt_oracle* oo);
+
+#endif
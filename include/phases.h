@@ -0,0 +1,85 @@
+/*
+ * phases.h
+ *
+ * Phase detection and representative intervals, in the manner of
+ * SimPoint. A profiling pass splits the trace into intervals of a fixed
+ * number of records and gives each a signature: the share of its accesses
+ * falling in each bucket of a hash of their block addresses. The
+ * signatures are clustered with k-means, and the interval nearest the
+ * centre of each cluster becomes its simpoint, weighted by the share of
+ * the trace's records in the cluster.
+ *
+ * A later run can simulate just the simpoints, each after a warmup of the
+ * records before it, and scale the hits, misses and evictions per record
+ * of every simpoint by its weight to estimate those of the whole trace.
+ *
+ * Simpoints are saved as text: a line "simpoints <interval> <records>"
+ * with the interval length and the records of the trace, then a line
+ * "simpoint <interval> <first record> <records> <weight>" for each.
+ */
+#ifndef PHASES_H
+#define PHASES_H
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+/* The buckets of a signature, and the most clusters looked for. */
+#define PHASE_DIMENSIONS 64
+#define MAX_PHASE_CLUSTERS 32
+#define DEFAULT_PHASE_CLUSTERS 4
+
+typedef struct {
+    /* The interval and the records it covers. */
+    long interval, first, records;
+    /* The share of the trace's records it stands for. */
+    double weight;
+    /* What simulating it counted, filled in by a simpoint run. */
+    int hits, misses, evictions;
+    bool simulated;
+} simpoint;
+
+typedef struct {
+    long interval_length, total_records, num_intervals;
+    simpoint points[MAX_PHASE_CLUSTERS];
+    int num_points;
+    /* The records a simpoint run simulated, warmups included. */
+    long simulated_records;
+} phase_profile;
+
+/*
+ * Profile the trace read from file, with blocks of 2^block_bits bytes, in
+ * intervals of interval_length records, and pick at most clusters
+ * simpoints. Returns NULL (after reporting why) if memory ran out.
+ */
+phase_profile* profile_phases(FILE* file, int block_bits,
+                              long interval_length, int clusters);
+
+/*
+ * Read simpoints saved by write_simpoints. Returns NULL, after reporting
+ * why, on error.
+ */
+phase_profile* read_simpoints(const char* path);
+
+/*
+ * Save the simpoints to path. Returns false if the file could not be
+ * written.
+ */
+bool write_simpoints(phase_profile* pp, const char* path);
+
+/* Free the profile. */
+void destroy_phase_profile(phase_profile* pp);
+
+/* Print the simpoints and their weights. */
+void print_phase_summary(phase_profile* pp);
+
+/*
+ * Estimate the hits, misses and evictions of the whole trace from the
+ * simpoints simulated.
+ */
+void estimate_phase_totals(phase_profile* pp, int* hits, int* misses,
+                           int* evictions);
+
+/* Print how much of the trace the estimate simulated. */
+void print_simpoint_summary(phase_profile* pp);
+
+#endif
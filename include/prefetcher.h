@@ -0,0 +1,128 @@
+/*
+ * prefetcher.h
+ *
+ * Hardware prefetcher models that can be attached to a cache_simulator.
+ * The simulator reports every demand access to its prefetcher, which
+ * decides which blocks to request. Requested blocks are filled into the
+ * cache once a configurable number of further demand accesses have passed.
+ *
+ *  next-line - on a miss, or the first use of a prefetched block, fetch
+ *              the following blocks.
+ *  stride    - tracks the block delta between accesses to the same 4KB
+ *              region, and once a delta repeats fetches along it.
+ *  stream    - allocates a stream on a miss, once a second access confirms
+ *              its direction the stream runs ahead of the demand accesses.
+ */
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+#include "cache_simulator.h"
+#include <stdbool.h>
+#include <inttypes.h>
+
+typedef enum {
+    PREFETCH_NONE, PREFETCH_NEXT_LINE, PREFETCH_STRIDE, PREFETCH_STREAM
+} prefetch_kind;
+
+/* The number of regions the stride prefetcher tracks at once. */
+#define STRIDE_ENTRIES 16
+/* The number of streams the stream prefetcher tracks at once. */
+#define STREAM_ENTRIES 8
+/* The number of prefetches that can be in flight at once. */
+#define PREFETCH_QUEUE 64
+/* The number of blocks evicted by prefetches that are remembered. */
+#define POLLUTION_FILTER 4096
+
+/* A region of memory being watched by the stride prefetcher. */
+typedef struct {
+    uint64_t region, last_block;
+    int64_t stride;
+    int confidence;
+    unsigned long last_use;
+    bool valid;
+} stride_entry;
+
+/* A stream being followed by the stream prefetcher. */
+typedef struct {
+    /* The last demand block in the stream. */
+    uint64_t last_block;
+    /* 1 or -1 once the stream is confirmed, 0 while training. */
+    int direction;
+    /* The furthest block requested so far. */
+    uint64_t next_prefetch;
+    unsigned long last_use;
+    bool valid;
+} stream_entry;
+
+/* A prefetch that has been issued but not yet filled. */
+typedef struct {
+    uint64_t block;
+    unsigned long ready_at;
+} pending_fill;
+
+typedef struct prefetcher {
+    prefetch_kind kind;
+    /* The number of blocks to fetch ahead of the demand stream. */
+    int degree;
+    /* The number of demand accesses that still miss a prefetch. */
+    int latency;
+    /* The number of demand accesses seen so far. */
+    unsigned long now;
+
+    stride_entry strides[STRIDE_ENTRIES];
+    stream_entry streams[STREAM_ENTRIES];
+
+    /* A ring buffer of the prefetches in flight, in arrival order. */
+    pending_fill pending[PREFETCH_QUEUE];
+    int pending_head, pending_count;
+
+    /* Blocks evicted by prefetch fills (stored plus one, 0 is empty). */
+    uint64_t evicted[POLLUTION_FILTER];
+
+    /*
+     * issued - prefetches sent to memory.
+     * useful - prefetched blocks later hit by a demand access.
+     * late - demand misses on a block that was still in flight.
+     * polluting - demand misses on a block a prefetch had evicted.
+     */
+    unsigned long issued, useful, late, polluting;
+} prefetcher;
+
+/*
+ * Construct a prefetcher of the given kind. Returns NULL if the
+ * memory could not be allocated.
+ */
+prefetcher* build_prefetcher(prefetch_kind kind, int degree, int latency);
+
+/* Free the resources used by the prefetcher. */
+void destroy_prefetcher(prefetcher* pf);
+
+/*
+ * Parse the name of a prefetcher ("next-line", "stride" or "stream").
+ * Returns PREFETCH_NONE if the name is not recognised.
+ */
+prefetch_kind parse_prefetch_kind(const char* name);
+
+/*
+ * Start a new demand access, filling every prefetch that has arrived
+ * into the cache.
+ */
+void prefetch_drain(prefetcher* pf, cache_simulator* cache, int inst_no);
+
+/*
+ * Record a demand miss on block, checking whether it was caused by a
+ * late or polluting prefetch.
+ */
+void prefetch_demand_miss(prefetcher* pf, uint64_t block);
+
+/*
+ * Let the prefetcher observe a demand access to block and issue any
+ * prefetches it triggers. tagged is set if the access missed or was the
+ * first use of a prefetched block.
+ */
+void prefetch_observe(prefetcher* pf, cache_simulator* cache, uint64_t block,
+                      bool tagged);
+
+/* Print the prefetch statistics. */
+void print_prefetch_summary(prefetcher* pf);
+
+#endif
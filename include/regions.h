@@ -0,0 +1,104 @@
+/*
+ * regions.h
+ *
+ * Restricts the statistics of a run to regions of interest in the trace.
+ * Every record still updates the cache, but only the hits, misses and
+ * evictions of records inside a region are counted. A record is inside a
+ * region if it is past the warmup and, when any are given, it lies in one
+ * of the record index ranges or between a pair of marker accesses (both
+ * markers included, as tracegen brackets each transpose function).
+ *
+ * Between markers, records at or above MARKER_STACK_FILTER still update the
+ * cache but are not counted, as test-trans drops them as valgrind's stack
+ * accesses when it cuts out the trace of each transpose function. The
+ * markers themselves pass through the same filter.
+ */
+#ifndef REGIONS_H
+#define REGIONS_H
+#include "cache_simulator.h"
+#include <stdbool.h>
+#include <inttypes.h>
+
+/* Accesses between markers at or above this address are not counted. */
+#define MARKER_STACK_FILTER 0xffffffffULL
+
+/* The most record index ranges that can be given. */
+#define MAX_ROI_RANGES 16
+
+/* The statistics of one contiguous region of the trace. */
+typedef struct {
+    /* The first and last record of the region. */
+    long first, last;
+    int hits, misses, evictions;
+} region_stats;
+
+/* How regions are chosen, filled in from the command line. */
+typedef struct {
+    /* The number of records to simulate before counting anything. */
+    long warmup;
+    /* Accesses to these addresses open and close a region. */
+    bool use_markers;
+    uint64_t marker_start, marker_end;
+    /* Inclusive ranges of record indices. */
+    long ranges[MAX_ROI_RANGES][2];
+    int num_ranges;
+} region_config;
+
+typedef struct {
+    region_config config;
+    /* Set while the records being simulated are counted. */
+    bool counting;
+    /* Set between a start and an end marker. */
+    bool in_markers;
+    /* The first record of the open region, and the cache's counts then. */
+    long first;
+    int base_hits, base_misses, base_evictions;
+    /* Set while simulating a filtered record, and the cache's counts then. */
+    bool filtered;
+    int skip_hits, skip_misses, skip_evictions;
+    /* Every region closed so far. */
+    region_stats* regions;
+    int num_regions, capacity;
+    /* The totals over every region. */
+    int hits, misses, evictions;
+} region_tracker;
+
+/* Returns true if config restricts counting at all. */
+bool regions_enabled(region_config* config);
+
+/*
+ * Parse a range of record indices "first:last" into config. Returns false
+ * on bad input or if there are too many ranges.
+ */
+bool parse_roi_range(const char* spec, region_config* config);
+
+/* Parse a pair of hex marker addresses "start:end" into config. */
+bool parse_roi_markers(const char* spec, region_config* config);
+
+/* Construct a tracker. Returns NULL if memory ran out. */
+region_tracker* build_region_tracker(region_config* config);
+
+/* Free the tracker. */
+void destroy_region_tracker(region_tracker* rt);
+
+/*
+ * Call before simulating the record with the given index and address.
+ * Opens a region if this record starts one.
+ */
+void region_begin_record(region_tracker* rt, cache_simulator* cache,
+                         long index, uint64_t address);
+
+/*
+ * Call after simulating the record with the given index and address.
+ * Closes the open region if this record ends it.
+ */
+void region_end_record(region_tracker* rt, cache_simulator* cache,
+                       long index, uint64_t address);
+
+/* Close the open region, if any, at the end of the trace. */
+void region_finish(region_tracker* rt, cache_simulator* cache, long index);
+
+/* Print the statistics of every region. */
+void print_region_summary(region_tracker* rt);
+
+#endif
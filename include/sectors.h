@@ -0,0 +1,66 @@
+/*
+ * sectors.h
+ *
+ * Sectored (sub-blocked) caches. Each line keeps one tag for a block of
+ * 2^b bytes, but the block is split into sectors that are fetched, and
+ * made dirty, on their own. An access whose tag is present but whose
+ * sector is not is a sector miss: only that sector is fetched and nothing
+ * is evicted. An access whose tag is absent is a tag miss, which replaces
+ * a line and fetches just the accessed sector.
+ *
+ * The sector map is attached to a cache_simulator and keeps the valid and
+ * dirty sectors of every line, paged like the lines themselves, along
+ * with the bytes fetched and written back. A conventional cache of the
+ * same shape would see the same tag misses, so its fill traffic is the
+ * tag misses times the block size.
+ */
+#ifndef SECTORS_H
+#define SECTORS_H
+#include "cache_simulator.h"
+#include <stdbool.h>
+#include <inttypes.h>
+
+/* The most sectors a block can be split into. */
+#define MAX_SECTORS 16
+
+typedef struct sector_map {
+    /* log2 of the sectors per block and of the bytes per sector */
+    int sector_bits, sector_offset_bits;
+    /* The lines of each page of the cache, and log2 of its sets per page. */
+    int ways, page_bits, page_lines, num_pages;
+    /* Per line, valid sectors in the low and dirty ones in the high half. */
+    uint32_t** pages;
+    unsigned long tag_misses, sector_misses;
+    uint64_t bytes_fetched, bytes_written_back;
+} sector_map;
+
+/*
+ * Construct a map splitting the blocks of cache into sectors, a power of
+ * two no greater than MAX_SECTORS or the bytes of a block. Returns NULL
+ * (after reporting why) on a bad number of sectors or if memory ran out.
+ */
+sector_map* build_sector_map(cache_simulator* cache, int sectors);
+
+/* Free the map. */
+void destroy_sector_map(sector_map* sm);
+
+/*
+ * Access the sector holding offset of the line in way of set, whose tag
+ * matched. Returns true if the sector was present; otherwise it is fetched
+ * as a sector miss. A write marks the sector dirty either way.
+ */
+bool sector_access(sector_map* sm, int set, int way, unsigned offset,
+                   bool write);
+
+/*
+ * Fill the line in way of set with a new block after a tag miss, writing
+ * back the dirty sectors of the block it held if evicts is set. Only the
+ * sector holding offset is fetched, or every sector if whole is set.
+ */
+void sector_fill(sector_map* sm, int set, int way, unsigned offset,
+                 bool write, bool evicts, bool whole);
+
+/* Print the misses and traffic of the sectors, and those of a block cache. */
+void print_sector_summary(sector_map* sm, int block_bits);
+
+#endif
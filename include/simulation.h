@@ -0,0 +1,86 @@
+/*
+ * simulation.h
+ *
+ * One run of the single cache simulator: a trace, the cache it drives and
+ * every model attached to it, built from the command line arguments. csim
+ * runs one of these; batch mode runs many side by side, so a simulation
+ * keeps all of its state to itself.
+ */
+#ifndef SIMULATION_H
+#define SIMULATION_H
+#include "args_reader.h"
+#include "cache_simulator.h"
+#include "checkpoint.h"
+#include "tlb.h"
+#include "regions.h"
+#include "timing.h"
+#include "intervals.h"
+#include "event_log.h"
+#include "trace_reducer.h"
+#include "trace_index.h"
+#include "opt_oracle.h"
+#include "trace_mux.h"
+#include "conflicts.h"
+#include "heatmap.h"
+#include "phases.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+typedef struct {
+    program_args* args;
+    FILE* trace;
+    /* the traces of the tenants interleaved in place of trace, if several */
+    trace_mux* mux;
+    /* where the run started, or the checkpoint it saved last */
+    trace_position position;
+    cache_simulator* cache;
+    /* the optional models, NULL when not asked for */
+    tlb* dtlb;
+    region_tracker* rt;
+    timing_model* tm;
+    event_log* log;
+    trace_reducer* reducer;
+    opt_oracle* opt;
+    conflict_analyzer* conflicts;
+    heatmap* heat;
+    /* the simpoints to simulate in place of the whole trace, if any */
+    phase_profile* phases;
+    FILE* reduce_out;
+    interval_stats intervals;
+    /* the sidecar index of the trace, when seeking or parsing in parallel */
+    trace_index* index;
+    /* the records parsed up front by several threads, if any */
+    instruction* parsed;
+    long num_parsed, next_parsed;
+    /* trace records simulated and the next instruction number */
+    long records;
+    int inst_no;
+    /* the record the run started at */
+    long first_record;
+    /* set if a record could not be simulated */
+    bool failed;
+} simulation;
+
+/*
+ * Open the trace and build the cache and models args asks for. Returns
+ * NULL (after reporting why) if that failed. args must outlive the run.
+ */
+simulation* build_simulation(program_args* args);
+
+/*
+ * Simulate the whole trace, saving checkpoints and logs along the way.
+ * Returns false (after reporting why) if a record could not be simulated.
+ */
+bool run_simulation(simulation* sim);
+
+/* The hits, misses and evictions counted, only in regions if given. */
+void simulation_totals(simulation* sim, int* hits, int* misses,
+                       int* evictions);
+
+/* Print the summary and the statistics of every attached model. */
+void print_simulation_summary(simulation* sim);
+
+/* Close the trace and free the cache and every model. */
+void destroy_simulation(simulation* sim);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * tenants.h
+ *
+ * Sharing one cache between tenants, such as services interleaved on a
+ * shared last level cache. Each access belongs to the tenant given by its
+ * stream (the third trace field, or the trace it came from when several
+ * are interleaved). Lines remember the tenant that filled them, and a
+ * tenant's fills can be restricted to a mask of ways, as with cache
+ * allocation technology; lookups still hit in any way.
+ *
+ * The table is attached to a cache_simulator and counts each tenant's
+ * hits, misses and evictions, how many of its lines other tenants evicted
+ * and how many lines it holds.
+ */
+#ifndef TENANTS_H
+#define TENANTS_H
+#include <stdbool.h>
+#include <inttypes.h>
+
+/* The most tenants that can share a cache, and the most ways a mask covers. */
+#define MAX_TENANTS 16
+#define MAX_MASK_WAYS 64
+
+typedef struct {
+    int hits, misses, evictions;
+    /* Lines of this tenant evicted by another tenant's fills. */
+    int interference;
+    /* The lines held now, and the sum of that over every access. */
+    long occupancy;
+    double occupancy_sum;
+} tenant_stats;
+
+typedef struct tenant_table {
+    /* The ways each tenant may fill, 0 for every way. */
+    uint64_t way_masks[MAX_TENANTS];
+    tenant_stats stats[MAX_TENANTS];
+    /* The tenant of the access being simulated. */
+    int current;
+    /* One more than the highest tenant seen. */
+    int num_tenants;
+    long accesses;
+} tenant_table;
+
+/*
+ * Parse "tenant:mask", with the mask in hex, into masks. Returns false on
+ * bad input.
+ */
+bool parse_way_mask(const char* spec, uint64_t* masks);
+
+/* Returns true if any tenant was restricted to some of the ways. */
+bool way_masks_given(uint64_t* masks);
+
+/*
+ * Construct a table for a cache with the given ways. Returns NULL (after
+ * reporting why) if a mask allows none of the ways, or memory ran out.
+ */
+tenant_table* build_tenant_table(uint64_t* masks, int ways);
+
+/* Free the table. */
+void destroy_tenant_table(tenant_table* tt);
+
+/*
+ * Make tenant the owner of the accesses that follow. tenant must be below
+ * MAX_TENANTS; streams above that are rejected as the trace is read.
+ */
+void tenant_begin_access(tenant_table* tt, unsigned tenant);
+
+/* The ways the current tenant may fill. */
+uint64_t tenant_way_mask(tenant_table* tt);
+
+/*
+ * Account for the current tenant filling a line, which held a block of
+ * victim_owner if evicts is set.
+ */
+void tenant_fill(tenant_table* tt, bool evicts, int victim_owner);
+
+/* Account for a line of owner being invalidated. */
+void tenant_release(tenant_table* tt, int owner);
+
+/* Print the statistics of every tenant seen. */
+void print_tenant_summary(tenant_table* tt);
+
+#endif
@@ -0,0 +1,92 @@
+/*
+ * timing.h
+ *
+ * A simple timing model that turns the outcome of each access into an
+ * estimated run time. Accesses issue in order, one per cycle, and never
+ * wait for each other's data. An access served by a cache level takes that
+ * level's hit latency. A miss to memory needs one of a bounded number of
+ * miss status holding registers (MSHRs), and when every MSHR is busy issue
+ * stalls until one frees. Any access to a block that already has one, a
+ * hit to the block just filled included, merges with it and completes
+ * when its data arrives. Memory can optionally transfer only one block per
+ * so many cycles, limiting bandwidth.
+ */
+#ifndef TIMING_H
+#define TIMING_H
+#include <stdbool.h>
+#include <inttypes.h>
+
+/* The most cache levels and MSHRs the model supports. */
+#define MAX_TIMING_LEVELS 4
+#define MAX_MSHRS 64
+
+/* The latencies and limits of the memory system. */
+typedef struct {
+    /* The hit latency of each level, the first level is looked up first. */
+    int hit_latency[MAX_TIMING_LEVELS];
+    int num_levels;
+    int memory_latency;
+    int mshrs;
+    /* Cycles memory is busy per block transferred, 0 for no limit. */
+    int transfer_cycles;
+} timing_config;
+
+/* A miss in flight. */
+typedef struct {
+    uint64_t block;
+    uint64_t done;
+} mshr;
+
+typedef struct {
+    timing_config config;
+    /* The cycle the next access issues in. */
+    uint64_t now;
+    /* The cycle the last access completes in. */
+    uint64_t end;
+    /* The first cycle memory is free to start another transfer. */
+    uint64_t bus_free;
+    mshr mshrs[MAX_MSHRS];
+    int active_mshrs;
+    /* accesses - accesses timed, total_latency - the sum of their latencies */
+    unsigned long accesses;
+    uint64_t total_latency;
+    /* misses - misses to memory, merged - accesses that joined a miss */
+    unsigned long misses, merged;
+    /* Cycles issue was stalled waiting for a free MSHR. */
+    uint64_t stall_cycles;
+    /* The sum of the durations of the misses, and of their union. */
+    uint64_t miss_cycles, busy_cycles;
+    /* The last cycle covered by the union of the misses. */
+    uint64_t busy_until;
+} timing_model;
+
+/*
+ * Parse a comma separated list of hit latencies, one per level, into
+ * config. Returns false on bad input.
+ */
+bool parse_hit_latencies(const char* spec, timing_config* config);
+
+/* Construct a timing model. Returns NULL if memory ran out. */
+timing_model* build_timing_model(timing_config* config);
+
+/* Free the timing model. */
+void destroy_timing_model(timing_model* tm);
+
+/*
+ * Time an access to block that was served by the given level, or by memory
+ * if level is num_levels. extra_cycles (such as a page walk) are added to
+ * its latency.
+ */
+void timing_access(timing_model* tm, uint64_t block, int level,
+                   int extra_cycles);
+
+/* The estimated cycles to run every access timed so far. */
+uint64_t timing_cycles(timing_model* tm);
+
+/* The average memory access time, in cycles. */
+double timing_amat(timing_model* tm);
+
+/* Print the estimated cycles, average memory access time and MLP. */
+void print_timing_summary(timing_model* tm);
+
+#endif
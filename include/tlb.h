@@ -0,0 +1,68 @@
+/*
+ * tlb.h
+ *
+ * A multi-level TLB model. Every level is a set associative cache of page
+ * translations, built on cache_simulator with the page offset used as the
+ * block offset. A translation that misses a level is looked up in the
+ * next one, and one that misses every level costs a page walk.
+ */
+#ifndef TLB_H
+#define TLB_H
+#include "cache_simulator.h"
+#include <stdbool.h>
+#include <inttypes.h>
+
+/* The most levels a TLB can have. */
+#define MAX_TLB_LEVELS 4
+
+/* The shape of a single TLB level. */
+typedef struct {
+    int entries, ways;
+    replacement_policy policy;
+} tlb_level_config;
+
+typedef struct {
+    /* The levels of the TLB, the first is looked up first. */
+    cache_simulator* levels[MAX_TLB_LEVELS];
+    int num_levels;
+    /* log2 of the page size. */
+    int page_bits;
+    /* The page table references made by a walk, and the cost of each. */
+    int walk_levels, walk_latency;
+    /* Translations looked up and page walks made. */
+    unsigned long accesses, walks;
+} tlb;
+
+/*
+ * Construct a TLB with the given levels, page size and page walk cost.
+ * Returns NULL if a level could not be allocated.
+ */
+tlb* build_tlb(tlb_level_config* configs, int num_levels, int page_bits,
+               int walk_latency);
+
+/* Free the resources used by the TLB. */
+void destroy_tlb(tlb* t);
+
+/*
+ * Parse a level of the form "entries:ways[:policy]". The number of sets
+ * (entries / ways) must be a power of two, and DIP and DRRIP need at least
+ * DUELING_MIN_SETS of them. Returns false on bad input.
+ */
+bool parse_tlb_level(const char* spec, tlb_level_config* config);
+
+/*
+ * Parse a page size such as "4K", "2M" or "1G" and store its log2 in
+ * page_bits. Returns false if the size is not a power of two.
+ */
+bool parse_page_size(const char* spec, int* page_bits);
+
+/*
+ * Translate the page containing address. Returns the level that held the
+ * translation, or num_levels if a page walk was needed.
+ */
+int tlb_access(tlb* t, uint64_t address, int inst_no);
+
+/* Print the per level hit and miss counts and the page walk estimate. */
+void print_tlb_summary(tlb* t);
+
+#endif
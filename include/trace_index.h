@@ -0,0 +1,83 @@
+/*
+ * trace_index.h
+ *
+ * A sidecar index for a text trace, kept next to it as <trace>.idx. The
+ * index holds the byte offset of every stride'th record and the number of
+ * records in the trace, so a run can seek straight to record K (reading at
+ * most stride - 1 records to get there) and threads can parse separate
+ * chunks of the trace at once.
+ *
+ * The index remembers the size and modification time of the trace it was
+ * built from and is ignored once the trace changes.
+ */
+#ifndef TRACE_INDEX_H
+#define TRACE_INDEX_H
+#include "instruction_reader.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#define TRACE_INDEX_MAGIC "CSIMTIDX"
+#define TRACE_INDEX_VERSION 1
+#define TRACE_INDEX_SUFFIX ".idx"
+
+/* The records between offsets of an index built without being asked. */
+#define DEFAULT_INDEX_STRIDE 4096
+
+/* The most threads that may parse a trace at once. */
+#define MAX_PARSE_THREADS 64
+
+/* The fixed size header at the start of an index file. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    /* the records between offsets */
+    uint32_t stride;
+    int64_t num_records;
+    int64_t num_chunks;
+    /* the trace the index describes */
+    int64_t trace_size, trace_mtime;
+} trace_index_header;
+
+typedef struct {
+    trace_index_header header;
+    /* the byte offset of record i * stride, for every chunk i */
+    int64_t* offsets;
+} trace_index;
+
+/*
+ * Read the trace at path once and index every stride'th record. Returns
+ * NULL (after reporting why) if the trace could not be read.
+ */
+trace_index* build_trace_index(const char* path, int stride);
+
+/*
+ * Write the index to the sidecar of the trace at path, replacing any old
+ * sidecar in one step.
+ */
+bool save_trace_index(trace_index* ti, const char* path);
+
+/*
+ * Load the sidecar of the trace at path. Returns NULL, silently, if there
+ * is none or it is out of date.
+ */
+trace_index* load_trace_index(const char* path);
+
+/* Free the index. */
+void destroy_trace_index(trace_index* ti);
+
+/*
+ * Position file, opened on the indexed trace, so the next record read is
+ * record. Returns false if the trace has fewer records.
+ */
+bool seek_trace_record(trace_index* ti, FILE* file, long record);
+
+/*
+ * Parse count records of the trace at path, starting at record first,
+ * into records, splitting the chunks among the given number of threads.
+ * Returns false (after reporting why) if the trace could not be read.
+ */
+bool parse_trace_parallel(trace_index* ti, const char* path, long first,
+                          long count, instruction* records, int threads);
+
+#endif
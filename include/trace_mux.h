@@ -0,0 +1,56 @@
+/*
+ * trace_mux.h
+ *
+ * Interleaves the instructions of several trace files into one stream.
+ * The files take turns, each contributing a quantum of instructions per
+ * turn (the same for every file unless a schedule weights them), and
+ * every instruction is tagged with the index of its file. A file that
+ * runs out drops out of the rotation.
+ */
+#ifndef TRACE_MUX_H
+#define TRACE_MUX_H
+#include "instruction_reader.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+/* The most trace files that can be interleaved. */
+#define MAX_TRACES 16
+
+typedef struct {
+    FILE* files[MAX_TRACES];
+    int num_files;
+    /* The number of instructions each file contributes per turn. */
+    int quanta[MAX_TRACES];
+    /* The file whose turn it is, and how much of its turn is used. */
+    int current, served;
+    /* The number of files that have not run out. */
+    int remaining;
+    bool done[MAX_TRACES];
+} trace_mux;
+
+/*
+ * Open every file in filenames for interleaving. Returns NULL if a file
+ * could not be opened (after reporting which) or memory ran out.
+ */
+trace_mux* open_trace_mux(char** filenames, int num_files, int quantum);
+
+/* Close every file and free the interleaver. */
+void close_trace_mux(trace_mux* mux);
+
+/*
+ * Parse a comma separated list of per file quanta, such as "3,1", into
+ * quanta. Returns the number of quanta, or 0 on bad input.
+ */
+int parse_schedule(const char* spec, int* quanta);
+
+/* Give each file its own quantum, files past num_quanta keep theirs. */
+void set_mux_schedule(trace_mux* mux, int* quanta, int num_quanta);
+
+/*
+ * Read the next instruction of the interleaved stream into inst. With
+ * more than one file inst->stream is set to the index of its file.
+ * Returns 0 once every file has run out.
+ */
+int mux_read_instruction(trace_mux* mux, instruction* inst);
+
+#endif
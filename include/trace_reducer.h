@@ -0,0 +1,54 @@
+/*
+ * trace_reducer.h
+ *
+ * Lossless trace reduction. Consecutive records with the same op and
+ * stream that touch the same block are folded into the first of them,
+ * whose repeat count says how many followed. Every folded access would
+ * have hit the block its run just brought in, without anything touching
+ * the cache in between, so a simulator only needs to count them as hits,
+ * and touch the block as a hit would (for SRRIP and the dueling policies,
+ * which can insert a block at the bottom of its set), to get exactly the
+ * hits, misses and evictions of the full trace. (Prefetchers only train on
+ * the first access of a run. Folded accesses do not advance the clock of
+ * prefetches in flight, and a region boundary could fall inside a run, so
+ * csim does not reduce with prefetch latency, warmup or regions.)
+ *
+ * A trace reduced for blocks of 2^b bytes stays exact for any cache with
+ * blocks at least that large. A sectored cache is reduced for its sectors.
+ */
+#ifndef TRACE_REDUCER_H
+#define TRACE_REDUCER_H
+#include "instruction_reader.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+typedef struct {
+    FILE* file;
+    int block_bits;
+    /* The record read past the end of the last run, if any. */
+    instruction next;
+    bool has_next;
+    /* records - records read, reduced - records returned */
+    unsigned long records, reduced;
+} trace_reducer;
+
+/*
+ * Reduce the trace read from file for blocks of 2^block_bits bytes.
+ * Returns NULL if memory ran out.
+ */
+trace_reducer* build_trace_reducer(FILE* file, int block_bits);
+
+/* Free the reducer, the file is left open. */
+void destroy_trace_reducer(trace_reducer* tr);
+
+/*
+ * Read the next run of the trace into inst, with its repeat count set.
+ * Returns 0 at the end of the trace, like read_instruction.
+ */
+int reduce_instruction(trace_reducer* tr, instruction* inst);
+
+/* Print how much the trace shrank. */
+void print_reduction_summary(trace_reducer* tr);
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * victim_cache.h
+ *
+ * A small fully associative buffer that can be attached to a
+ * cache_simulator to catch conflict misses.
+ *
+ *  victim cache - holds the blocks most recently replaced in the cache.
+ *                 A miss that finds its block here swaps it back.
+ *  miss cache   - holds copies of the blocks most recently missed on.
+ *
+ * The buffer never changes what the cache itself holds, so the cache's
+ * hit, miss and eviction counts are the same with or without it. Its
+ * hits are the cache misses it would have served.
+ */
+#ifndef VICTIM_CACHE_H
+#define VICTIM_CACHE_H
+#include <stdbool.h>
+#include <inttypes.h>
+
+typedef enum { VICTIM_CACHE, MISS_CACHE } victim_kind;
+
+typedef struct victim_cache {
+    victim_kind kind;
+    /* The number of blocks the buffer holds. */
+    int num_entries;
+    /* The block in each entry plus one, 0 marks an empty entry. */
+    uint64_t* blocks;
+    /* When each entry was last used, for LRU replacement. */
+    unsigned long* last_use;
+    unsigned long now;
+    /* probes - cache misses looked up here, hits - probes that found
+     * their block */
+    unsigned long probes, hits;
+} victim_cache;
+
+/*
+ * Construct a victim or miss cache with the given number of entries.
+ * Returns NULL if the memory could not be allocated.
+ */
+victim_cache* build_victim_cache(victim_kind kind, int num_entries);
+
+/* Free the resources used by the victim cache. */
+void destroy_victim_cache(victim_cache* vc);
+
+/*
+ * Look up a block the cache missed on. Returns true if the buffer held it.
+ * A victim cache gives the block back to the cache, a miss cache keeps
+ * its copy and records the missed block if it did not have it.
+ */
+bool victim_probe(victim_cache* vc, uint64_t block);
+
+/*
+ * Record a block replaced in the cache. Only a victim cache keeps it.
+ */
+void victim_insert(victim_cache* vc, uint64_t block);
+
+/* Print the victim cache statistics, misses being probes that missed. */
+void print_victim_summary(victim_cache* vc);
+
+#endif
@@ -3,13 +3,145 @@
  * Author: Josh Leath
  * Last Updated: 6/5/17
  */
+#define _POSIX_C_SOURCE 200809L
 #include "../include/args_reader.h"
+#include "../include/batch.h"
+#include "../include/trace_index.h"
+#include "../include/heatmap.h"
+#include "../include/phases.h"
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <getopt.h>
 
+/* The options that only have a long form. */
+static const struct option long_options[] = {
+    {"prefetch", required_argument, NULL, OPT_PREFETCH},
+    {"prefetch-degree", required_argument, NULL, OPT_PREFETCH_DEGREE},
+    {"prefetch-latency", required_argument, NULL, OPT_PREFETCH_LATENCY},
+    {"victim-cache", required_argument, NULL, OPT_VICTIM_CACHE},
+    {"miss-cache", required_argument, NULL, OPT_MISS_CACHE},
+    {"policy", required_argument, NULL, OPT_POLICY},
+    {"tlb", required_argument, NULL, OPT_TLB},
+    {"page-size", required_argument, NULL, OPT_PAGE_SIZE},
+    {"walk-latency", required_argument, NULL, OPT_WALK_LATENCY},
+    {"sets", required_argument, NULL, OPT_SETS},
+    {"index", required_argument, NULL, OPT_INDEX},
+    {"cores", required_argument, NULL, OPT_CORES},
+    {"coherence", required_argument, NULL, OPT_COHERENCE},
+    {"shared-cache", required_argument, NULL, OPT_SHARED_CACHE},
+    {"quantum", required_argument, NULL, OPT_QUANTUM},
+    {"checkpoint-out", required_argument, NULL, OPT_CHECKPOINT_OUT},
+    {"checkpoint-at", required_argument, NULL, OPT_CHECKPOINT_AT},
+    {"restore", required_argument, NULL, OPT_RESTORE},
+    {"warmup", required_argument, NULL, OPT_WARMUP},
+    {"roi", required_argument, NULL, OPT_ROI},
+    {"roi-markers", required_argument, NULL, OPT_ROI_MARKERS},
+    {"timing", no_argument, NULL, OPT_TIMING},
+    {"hit-latency", required_argument, NULL, OPT_HIT_LATENCY},
+    {"memory-latency", required_argument, NULL, OPT_MEMORY_LATENCY},
+    {"mshrs", required_argument, NULL, OPT_MSHRS},
+    {"bandwidth", required_argument, NULL, OPT_BANDWIDTH},
+    {"interval", required_argument, NULL, OPT_INTERVAL},
+    {"event-log", required_argument, NULL, OPT_EVENT_LOG},
+    {"reduce", no_argument, NULL, OPT_REDUCE},
+    {"reduce-out", required_argument, NULL, OPT_REDUCE_OUT},
+    {"batch", required_argument, NULL, OPT_BATCH},
+    {"batch-out", required_argument, NULL, OPT_BATCH_OUT},
+    {"jobs", required_argument, NULL, OPT_JOBS},
+    {"build-index", required_argument, NULL, OPT_BUILD_INDEX},
+    {"start-at", required_argument, NULL, OPT_START_AT},
+    {"max-records", required_argument, NULL, OPT_MAX_RECORDS},
+    {"parse-threads", required_argument, NULL, OPT_PARSE_THREADS},
+    {"memory-report", no_argument, NULL, OPT_MEMORY_REPORT},
+    {"tenants", no_argument, NULL, OPT_TENANTS},
+    {"way-mask", required_argument, NULL, OPT_WAY_MASK},
+    {"schedule", required_argument, NULL, OPT_SCHEDULE},
+    {"conflicts", required_argument, NULL, OPT_CONFLICTS},
+    {"heatmap", required_argument, NULL, OPT_HEATMAP},
+    {"heatmap-region", required_argument, NULL, OPT_HEATMAP_REGION},
+    {"symbols", required_argument, NULL, OPT_SYMBOLS},
+    {"heatmap-top", required_argument, NULL, OPT_HEATMAP_TOP},
+    {"phases", required_argument, NULL, OPT_PHASES},
+    {"phase-clusters", required_argument, NULL, OPT_PHASE_CLUSTERS},
+    {"simpoints-out", required_argument, NULL, OPT_SIMPOINTS_OUT},
+    {"simpoints", required_argument, NULL, OPT_SIMPOINTS},
+    {"simpoint-warmup", required_argument, NULL, OPT_SIMPOINT_WARMUP},
+    {"sectors", required_argument, NULL, OPT_SECTORS},
+    {NULL, 0, NULL, 0}
+};
+
+/*
+ * Sets every field of ARGS to its default value.
+ */
+void init_args(program_args* args)
+{
+    args->s = args->b = args->E = 0;
+    args->verbose = false;
+    args->ref_filename = NULL;
+    args->num_traces = 0;
+    args->prefetch = PREFETCH_NONE;
+    args->prefetch_degree = 1;
+    args->prefetch_latency = 0;
+    args->victim_entries = 0;
+    args->victim = VICTIM_CACHE;
+    args->policy = REPLACE_LRU;
+    args->num_tlb_levels = 0;
+    args->page_bits = 12;
+    args->walk_latency = 30;
+    args->num_sets = 0;
+    args->index_fn = INDEX_BIT_SLICE;
+    args->policy_given = args->index_given = false;
+    args->cores = 0;
+    args->protocol = PROTOCOL_MESI;
+    args->shared_s = args->shared_E = 0;
+    args->quantum = 1;
+    args->checkpoint_out = NULL;
+    args->checkpoint_at = -1;
+    args->restore_filename = NULL;
+    args->regions.warmup = 0;
+    args->regions.use_markers = false;
+    args->regions.num_ranges = 0;
+    args->timing = false;
+    args->timing_config.hit_latency[0] = 4;
+    args->timing_config.hit_latency[1] = 6;
+    args->timing_config.num_levels = 2;
+    args->timing_config.memory_latency = 200;
+    args->timing_config.mshrs = 8;
+    args->timing_config.transfer_cycles = 0;
+    args->interval = 0;
+    args->event_log = NULL;
+    args->reduce = false;
+    args->reduce_out = NULL;
+    args->batch_filename = NULL;
+    args->batch_out = NULL;
+    args->jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if (args->jobs <= 0)
+        args->jobs = 1;
+    args->build_index = 0;
+    args->start_at = 0;
+    args->max_records = -1;
+    args->parse_threads = 0;
+    args->memory_report = false;
+    args->tenants = false;
+    for (int i = 0; i < MAX_TENANTS; ++i)
+        args->way_masks[i] = 0;
+    args->num_schedule = 0;
+    args->conflict_bits = 0;
+    args->heatmap = false;
+    args->heatmap_out = NULL;
+    args->heatmap_bits = 12;
+    args->symbols_file = NULL;
+    args->heatmap_top = DEFAULT_HEATMAP_TOP;
+    args->phase_interval = 0;
+    args->phase_clusters = DEFAULT_PHASE_CLUSTERS;
+    args->simpoints_out = NULL;
+    args->simpoints_file = NULL;
+    args->simpoint_warmup = -1;
+    args->sectors = 0;
+}
+
 /*
  * A helper function for reading the arguments to the csim program.
  * Returns 0 if the args were not entered properly, else 1.
@@ -17,7 +149,7 @@
 int get_args(program_args* args, int argc, char** argv)
 {
     int op;
-    while ((op = getopt(argc, argv, OPT_STR)) != -1) {
+    while ((op = getopt_long(argc, argv, OPT_STR, long_options, NULL)) != -1) {
         switch (op) {
             case 'h':
                 printf("%s\n", USAGE_STR);
@@ -35,12 +167,277 @@ int get_args(program_args* args, int argc, char** argv)
                 args->b = atoi(optarg);
                 break;
             case 't':
-                args->ref_filename = optarg;
+                if (args->num_traces == MAX_TRACES)
+                    return 0;
+                args->trace_files[args->num_traces++] = optarg;
+                args->ref_filename = args->trace_files[0];
+                break;
+            case OPT_PREFETCH:
+                args->prefetch = parse_prefetch_kind(optarg);
+                if (args->prefetch == PREFETCH_NONE)
+                    return 0;
+                break;
+            case OPT_PREFETCH_DEGREE:
+                args->prefetch_degree = atoi(optarg);
+                break;
+            case OPT_PREFETCH_LATENCY:
+                args->prefetch_latency = atoi(optarg);
+                break;
+            case OPT_VICTIM_CACHE:
+            case OPT_MISS_CACHE:
+                args->victim_entries = atoi(optarg);
+                args->victim = op == OPT_VICTIM_CACHE ? VICTIM_CACHE
+                                                      : MISS_CACHE;
+                if (args->victim_entries <= 0)
+                    return 0;
+                break;
+            case OPT_POLICY:
+                if (! parse_replacement_policy(optarg, &args->policy))
+                    return 0;
+                args->policy_given = true;
+                break;
+            case OPT_TLB:
+                if (args->num_tlb_levels == MAX_TLB_LEVELS
+                        || ! parse_tlb_level(optarg,
+                            &args->tlb_levels[args->num_tlb_levels]))
+                    return 0;
+                args->num_tlb_levels += 1;
+                break;
+            case OPT_PAGE_SIZE:
+                if (! parse_page_size(optarg, &args->page_bits))
+                    return 0;
+                break;
+            case OPT_WALK_LATENCY:
+                args->walk_latency = atoi(optarg);
+                break;
+            case OPT_SETS:
+                args->num_sets = atoi(optarg);
+                if (args->num_sets <= 0)
+                    return 0;
+                break;
+            case OPT_INDEX:
+                if (! parse_index_function(optarg, &args->index_fn))
+                    return 0;
+                args->index_given = true;
+                break;
+            case OPT_CORES:
+                args->cores = atoi(optarg);
+                if (args->cores <= 0 || args->cores > MAX_CORES)
+                    return 0;
+                break;
+            case OPT_COHERENCE:
+                if (! parse_coherence_protocol(optarg, &args->protocol))
+                    return 0;
+                break;
+            case OPT_SHARED_CACHE:
+                if (sscanf(optarg, "%d:%d", &args->shared_s,
+                           &args->shared_E) != 2
+                        || args->shared_s <= 0 || args->shared_E <= 0)
+                    return 0;
+                break;
+            case OPT_QUANTUM:
+                args->quantum = atoi(optarg);
+                if (args->quantum <= 0)
+                    return 0;
+                break;
+            case OPT_CHECKPOINT_OUT:
+                args->checkpoint_out = optarg;
+                break;
+            case OPT_CHECKPOINT_AT:
+                args->checkpoint_at = atol(optarg);
+                if (args->checkpoint_at < 0)
+                    return 0;
+                break;
+            case OPT_RESTORE:
+                args->restore_filename = optarg;
+                break;
+            case OPT_WARMUP:
+                args->regions.warmup = atol(optarg);
+                if (args->regions.warmup < 0)
+                    return 0;
+                break;
+            case OPT_ROI:
+                if (! parse_roi_range(optarg, &args->regions))
+                    return 0;
+                break;
+            case OPT_ROI_MARKERS:
+                if (! parse_roi_markers(optarg, &args->regions))
+                    return 0;
+                break;
+            case OPT_TIMING:
+                args->timing = true;
+                break;
+            case OPT_HIT_LATENCY:
+                args->timing = true;
+                if (! parse_hit_latencies(optarg, &args->timing_config))
+                    return 0;
+                break;
+            case OPT_MEMORY_LATENCY:
+                args->timing = true;
+                args->timing_config.memory_latency = atoi(optarg);
+                if (args->timing_config.memory_latency < 0)
+                    return 0;
+                break;
+            case OPT_MSHRS:
+                args->timing = true;
+                args->timing_config.mshrs = atoi(optarg);
+                if (args->timing_config.mshrs <= 0
+                        || args->timing_config.mshrs > MAX_MSHRS)
+                    return 0;
+                break;
+            case OPT_BANDWIDTH:
+                args->timing = true;
+                args->timing_config.transfer_cycles = atoi(optarg);
+                if (args->timing_config.transfer_cycles < 0)
+                    return 0;
                 break;
+            case OPT_INTERVAL:
+                args->interval = atol(optarg);
+                if (args->interval <= 0)
+                    return 0;
+                break;
+            case OPT_EVENT_LOG:
+                args->event_log = optarg;
+                break;
+            case OPT_REDUCE:
+                args->reduce = true;
+                break;
+            case OPT_REDUCE_OUT:
+                args->reduce = true;
+                args->reduce_out = optarg;
+                break;
+            case OPT_BATCH:
+                args->batch_filename = optarg;
+                break;
+            case OPT_BATCH_OUT:
+                args->batch_out = optarg;
+                break;
+            case OPT_JOBS:
+                args->jobs = atoi(optarg);
+                if (args->jobs <= 0 || args->jobs > MAX_BATCH_THREADS)
+                    return 0;
+                break;
+            case OPT_BUILD_INDEX:
+                args->build_index = atoi(optarg);
+                if (args->build_index <= 0)
+                    return 0;
+                break;
+            case OPT_START_AT:
+                args->start_at = atol(optarg);
+                if (args->start_at < 0)
+                    return 0;
+                break;
+            case OPT_MAX_RECORDS:
+                args->max_records = atol(optarg);
+                if (args->max_records < 0)
+                    return 0;
+                break;
+            case OPT_PARSE_THREADS:
+                args->parse_threads = atoi(optarg);
+                if (args->parse_threads <= 0
+                        || args->parse_threads > MAX_PARSE_THREADS)
+                    return 0;
+                break;
+            case OPT_MEMORY_REPORT:
+                args->memory_report = true;
+                break;
+            case OPT_TENANTS:
+                args->tenants = true;
+                break;
+            case OPT_WAY_MASK:
+                args->tenants = true;
+                if (! parse_way_mask(optarg, args->way_masks))
+                    return 0;
+                break;
+            case OPT_SCHEDULE:
+                args->num_schedule = parse_schedule(optarg, args->schedule);
+                if (args->num_schedule == 0)
+                    return 0;
+                break;
+            case OPT_CONFLICTS:
+                if (! parse_page_size(optarg, &args->conflict_bits))
+                    return 0;
+                break;
+            case OPT_HEATMAP:
+                args->heatmap = true;
+                args->heatmap_out = optarg;
+                break;
+            case OPT_HEATMAP_REGION:
+                args->heatmap = true;
+                if (! parse_page_size(optarg, &args->heatmap_bits))
+                    return 0;
+                break;
+            case OPT_SYMBOLS:
+                args->heatmap = true;
+                args->symbols_file = optarg;
+                break;
+            case OPT_HEATMAP_TOP:
+                args->heatmap = true;
+                args->heatmap_top = atoi(optarg);
+                if (args->heatmap_top < 0)
+                    return 0;
+                break;
+            case OPT_PHASES:
+                args->phase_interval = atol(optarg);
+                if (args->phase_interval <= 0)
+                    return 0;
+                break;
+            case OPT_PHASE_CLUSTERS:
+                args->phase_clusters = atoi(optarg);
+                if (args->phase_clusters <= 0
+                        || args->phase_clusters > MAX_PHASE_CLUSTERS)
+                    return 0;
+                break;
+            case OPT_SIMPOINTS_OUT:
+                args->simpoints_out = optarg;
+                break;
+            case OPT_SIMPOINTS:
+                args->simpoints_file = optarg;
+                break;
+            case OPT_SIMPOINT_WARMUP:
+                args->simpoint_warmup = atol(optarg);
+                if (args->simpoint_warmup < 0)
+                    return 0;
+                break;
+            case OPT_SECTORS:
+                args->sectors = atoi(optarg);
+                if (args->sectors <= 0)
+                    return 0;
+                break;
+            default:
+                return 0;
         }
     }
-    if (args->ref_filename == NULL || args->b <= 0 || args->s <= 0
-            || args->E <= 0)
+    /* the jobs of a batch bring their own arguments */
+    if (args->batch_filename)
+        return 1;
+    if (args->ref_filename == NULL)
+        return 0;
+    /* a restored cache takes its shape from the checkpoint */
+    if (args->restore_filename == NULL && (args->b <= 0
+            || (args->s <= 0 && args->num_sets == 0) || args->E <= 0))
+        return 0;
+    /* more sets than an int can count could not be addressed */
+    if (args->s > MAX_SET_BITS || args->shared_s > MAX_SET_BITS
+            || args->num_sets > 1 << MAX_SET_BITS)
+        return 0;
+    /*
+     * with several traces each one runs on its own core, unless they are
+     * tenants of a single cache
+     */
+    if (args->cores == 0)
+        args->cores = args->tenants ? 1 : args->num_traces;
+    if (args->tenants && args->cores > 1)
+        return 0;
+    if ((args->cores < args->num_traces && ! args->tenants)
+            || args->cores > MAX_CORES)
+        return 0;
+    /* a bit slice can only select from a power of two number of sets */
+    if ((args->num_sets & (args->num_sets - 1)) != 0
+            && args->index_fn == INDEX_BIT_SLICE)
+        args->index_fn = INDEX_MODULO;
+    if (args->prefetch_degree <= 0 || args->prefetch_latency < 0
+            || args->walk_latency < 0)
         return 0;
     return 1;
 }
@@ -57,5 +454,101 @@ void report_failure(void)
     printf("-s <num>\tNumber of set index bits.\n");
     printf("-E <num>\tNumber of lines per set.\n");
     printf("-b <num>\tNumber of block offset bits.\n");
-    printf("-t <file>\tTrace file.\n");
+    printf("-t <file>\tTrace file, - for stdin, repeat to give each core its"
+           " own trace.\n");
+    printf("--prefetch <kind>\tAttach a next-line, stride or stream"
+           " prefetcher.\n");
+    printf("--prefetch-degree <num>\tBlocks fetched ahead (default 1).\n");
+    printf("--prefetch-latency <num>\tAccesses before a prefetch arrives"
+           " (default 0).\n");
+    printf("--sectors <num>\tSplit each block into num sectors filled on"
+           " their own.\n");
+    printf("--victim-cache <num>\tAttach a victim cache with num entries.\n");
+    printf("--miss-cache <num>\tAttach a miss cache with num entries.\n");
+    printf("--sets <num>\tNumber of sets, need not be a power of two"
+           " (replaces -s).\n");
+    printf("--index <name>\tSet index function: slice (default), mod, xor,"
+           " prime or skew.\n");
+    printf("--cores <num>\tSimulate num coherent cores, the third trace"
+           " field picks the core.\n");
+    printf("--coherence <name>\tCoherence protocol: mesi (default) or"
+           " moesi.\n");
+    printf("--shared-cache <s:E>\tAdd a cache shared by the cores.\n");
+    printf("--quantum <num>\tAccesses per turn when interleaving traces"
+           " (default 1).\n");
+    printf("--schedule <n0,n1,...>\tAccesses per turn of each trace when"
+           " interleaving.\n");
+    printf("--tenants\tReport per tenant statistics, the stream or trace"
+           " is the tenant.\n");
+    printf("--way-mask <tenant:hexmask>\tOnly let tenant fill these ways,"
+           " may be repeated.\n");
+    printf("--checkpoint-out <file>\tSave the cache and trace position to"
+           " file.\n");
+    printf("--checkpoint-at <num>\tSave after num trace records (default:"
+           " the end).\n");
+    printf("--restore <file>\tStart from a checkpoint of the same trace"
+           " (-s, -E, -b optional).\n");
+    printf("--warmup <num>\tSimulate num trace records before counting.\n");
+    printf("--roi <first:last>\tOnly count these trace records, may be"
+           " repeated.\n");
+    printf("--roi-markers <start:end>\tOnly count between accesses to these"
+           " hex addresses.\n");
+    printf("--event-log <file>\tWrite the outcome of every access to a"
+           " binary log.\n");
+    printf("--reduce\tFold runs of accesses to the same block into one"
+           " record.\n");
+    printf("--reduce-out <file>\tWrite the reduced trace to file (implies"
+           " --reduce).\n");
+    printf("--batch <file>\tRun every job (a line of csim arguments) in"
+           " file.\n");
+    printf("--batch-out <file>\tWrite the batch results as CSV, or JSON if"
+           " file ends in .json.\n");
+    printf("--jobs <num>\tThreads running the batch (default: one per"
+           " CPU).\n");
+    printf("--build-index <num>\tIndex every num'th record of the trace in"
+           " <trace>.idx.\n");
+    printf("--start-at <num>\tStart simulating at trace record num, using"
+           " the index.\n");
+    printf("--max-records <num>\tSimulate at most num trace records.\n");
+    printf("--parse-threads <num>\tParse the trace up front with num"
+           " threads.\n");
+    printf("--memory-report\tPrint the memory the cache lines take.\n");
+    printf("--heatmap <file>\tWrite accesses, misses and evictions per set"
+           " and region as CSV, or JSON.\n");
+    printf("--heatmap-region <size>\tHeatmap region size, e.g. 4K"
+           " (default).\n");
+    printf("--symbols <file>\tUse the \"name start end\" ranges in file"
+           " as heatmap regions.\n");
+    printf("--heatmap-top <num>\tPrint the num sets and regions with the most"
+           " misses (default 10).\n");
+    printf("--phases <num>\tProfile phases in intervals of num records and"
+           " pick simpoints, without simulating.\n");
+    printf("--phase-clusters <num>\tThe most simpoints to pick (default"
+           " 4).\n");
+    printf("--simpoints-out <file>\tSave the simpoints picked to file.\n");
+    printf("--simpoints <file>\tOnly simulate these simpoints and estimate"
+           " the whole trace.\n");
+    printf("--simpoint-warmup <num>\tRecords simulated before each simpoint"
+           " (default: one interval).\n");
+    printf("--conflicts <size>\tRank conflicts between regions of size"
+           " bytes, e.g. 4K, and test padding fixes.\n");
+    printf("--interval <num>\tPrint statistics every num trace records.\n");
+    printf("--timing\tEstimate cycles, average memory access time and"
+           " MLP.\n");
+    printf("--hit-latency <l1[,l2]>\tHit latency of the cache and victim"
+           " cache (default 4,6).\n");
+    printf("--memory-latency <num>\tCycles to fetch a block from memory"
+           " (default 200).\n");
+    printf("--mshrs <num>\tMisses that may be outstanding at once"
+           " (default 8).\n");
+    printf("--bandwidth <num>\tCycles memory needs per block (default 0,"
+           " unlimited).\n");
+    printf("--policy <name>\tReplacement policy: lru (default), fifo, random,"
+           " opt, srrip, dip or drrip.\n");
+    printf("--tlb <entries:ways[:policy]>\tAdd a TLB level, may be"
+           " repeated.\n");
+    printf("--page-size <size>\tTLB page size, e.g. 4K (default), 2M or"
+           " 1G.\n");
+    printf("--walk-latency <num>\tCycles per page walk reference"
+           " (default 30).\n");
 }
@@ -0,0 +1,285 @@
+/*
+ * batch.c
+ * Running a manifest of simulations on a thread pool.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "../include/batch.h"
+#include "../include/args_reader.h"
+#include "../include/simulation.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+
+/* The longest manifest line. */
+#define BATCH_LINE 4096
+
+/* Returns the current time in seconds. */
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Split job->line at whitespace into job->argv, after a program name. */
+static bool split_job(batch_job* job)
+{
+    char* curr = job->line;
+    job->argv[0] = "csim";
+    job->argc = 1;
+    while (*curr != '\0') {
+        while (isspace((unsigned char) *curr))
+            *curr++ = '\0';
+        if (*curr == '\0')
+            break;
+        if (job->argc == MAX_BATCH_ARGS - 1)
+            return false;
+        job->argv[job->argc++] = curr;
+        while (*curr != '\0' && ! isspace((unsigned char) *curr))
+            curr++;
+    }
+    job->argv[job->argc] = NULL;
+    return true;
+}
+
+/*
+ * Parse the arguments of a job, read from line line_no of path, the way csim
+ * parses its command line. Reports why the job is not valid.
+ */
+static bool parse_job(batch_job* job, const char* path, int line_no)
+{
+    program_args* args = &job->args;
+    const char* mode = NULL;
+    init_args(args);
+    /* start getopt over for every job */
+    optind = 0;
+    if (! split_job(job) || ! get_args(args, job->argc, job->argv)
+            || strcmp(args->ref_filename, "-") == 0) {
+        printf("ERROR: %s:%d is not a valid single cache job\n", path,
+               line_no);
+        return false;
+    }
+    if (args->batch_filename)
+        mode = "--batch";
+    else if (args->cores > 1)
+        mode = "--cores";
+    else if (args->phase_interval > 0)
+        mode = "--phases";
+    if (mode) {
+        printf("ERROR: %s:%d uses %s, which a batch job cannot use\n",
+               path, line_no, mode);
+        return false;
+    }
+    args->verbose = false;
+    args->interval = 0;
+    return true;
+}
+
+/* Append an empty job to the batch. Returns NULL if memory ran out. */
+static batch_job* add_job(batch* b)
+{
+    if (b->num_jobs == b->capacity) {
+        int capacity = b->capacity ? b->capacity * 2 : 16;
+        batch_job* grown = realloc(b->jobs, capacity * sizeof(batch_job));
+        if (grown == NULL)
+            return NULL;
+        b->jobs = grown;
+        b->capacity = capacity;
+    }
+    batch_job* job = &b->jobs[b->num_jobs++];
+    memset(job, 0, sizeof(batch_job));
+    return job;
+}
+
+/* Run one job and store its results. */
+static void run_job(batch_job* job)
+{
+    double start = now_seconds();
+    simulation* sim = build_simulation(&job->args);
+    if (! sim)
+        return;
+    if (! run_simulation(sim)) {
+        destroy_simulation(sim);
+        return;
+    }
+    simulation_totals(sim, &job->hits, &job->misses, &job->evictions);
+    job->records = sim->records;
+    if (sim->tm) {
+        job->timed = true;
+        job->cycles = timing_cycles(sim->tm);
+        job->amat = timing_amat(sim->tm);
+    }
+    destroy_simulation(sim);
+    job->seconds = now_seconds() - start;
+    job->done = true;
+}
+
+/* A worker thread, taking jobs until there are none left. */
+static void* batch_worker(void* data)
+{
+    batch* b = data;
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        int next = b->next_job++;
+        pthread_mutex_unlock(&b->lock);
+        if (next >= b->num_jobs)
+            return NULL;
+        run_job(&b->jobs[next]);
+    }
+}
+
+/* Write text as a quoted CSV or JSON string, escaping quotes. */
+static void put_quoted(FILE* file, const char* text, bool json)
+{
+    fputc('"', file);
+    for (; *text != '\0'; ++text) {
+        if (*text == '"')
+            fputs(json ? "\\\"" : "\"\"", file);
+        else if (json && *text == '\\')
+            fputs("\\\\", file);
+        else
+            fputc(*text, file);
+    }
+    fputc('"', file);
+}
+
+static void write_csv(batch* b, FILE* file)
+{
+    fprintf(file, "job,args,status,hits,misses,evictions,records,cycles,"
+            "amat,seconds\n");
+    for (int i = 0; i < b->num_jobs; ++i) {
+        batch_job* job = &b->jobs[i];
+        fprintf(file, "%d,", i);
+        put_quoted(file, job->text, false);
+        if (! job->done) {
+            fprintf(file, ",error,,,,,,,\n");
+            continue;
+        }
+        fprintf(file, ",ok,%d,%d,%d,%ld,", job->hits, job->misses,
+                job->evictions, job->records);
+        if (job->timed)
+            fprintf(file, "%" PRIu64 ",%.4f", job->cycles, job->amat);
+        else
+            fprintf(file, ",");
+        fprintf(file, ",%.6f\n", job->seconds);
+    }
+}
+
+static void write_json(batch* b, FILE* file)
+{
+    fprintf(file, "[\n");
+    for (int i = 0; i < b->num_jobs; ++i) {
+        batch_job* job = &b->jobs[i];
+        fprintf(file, "  {\"job\": %d, \"args\": ", i);
+        put_quoted(file, job->text, true);
+        if (! job->done) {
+            fprintf(file, ", \"status\": \"error\"}");
+        } else {
+            fprintf(file, ", \"status\": \"ok\", \"hits\": %d, \"misses\": %d,"
+                    " \"evictions\": %d, \"records\": %ld", job->hits,
+                    job->misses, job->evictions, job->records);
+            if (job->timed)
+                fprintf(file, ", \"cycles\": %" PRIu64 ", \"amat\": %.4f",
+                        job->cycles, job->amat);
+            fprintf(file, ", \"seconds\": %.6f}", job->seconds);
+        }
+        fprintf(file, "%s\n", i + 1 < b->num_jobs ? "," : "");
+    }
+    fprintf(file, "]\n");
+}
+
+batch* read_batch_manifest(const char* path)
+{
+    char buffer[BATCH_LINE];
+    int line_no = 0;
+    FILE* file = fopen(path, "r");
+    if (! file) {
+        printf("ERROR: Failed to open batch manifest: %s\n", path);
+        return NULL;
+    }
+    batch* b = calloc(1, sizeof(batch));
+    if (b == NULL) {
+        printf("Unable to allocate memory for batch -- aborting.\n\n");
+        fclose(file);
+        return NULL;
+    }
+    pthread_mutex_init(&b->lock, NULL);
+
+    while (fgets(buffer, sizeof(buffer), file)) {
+        char* start = buffer;
+        line_no += 1;
+        buffer[strcspn(buffer, "\r\n")] = '\0';
+        while (isspace((unsigned char) *start))
+            start++;
+        if (*start == '\0' || *start == '#')
+            continue;
+        batch_job* job = add_job(b);
+        if (job == NULL || (job->text = strdup(start)) == NULL
+                || (job->line = strdup(start)) == NULL) {
+            printf("Unable to allocate memory for batch -- aborting.\n\n");
+            fclose(file);
+            destroy_batch(b);
+            return NULL;
+        }
+        if (! parse_job(job, path, line_no)) {
+            fclose(file);
+            destroy_batch(b);
+            return NULL;
+        }
+    }
+    fclose(file);
+    return b;
+}
+
+void destroy_batch(batch* b)
+{
+    for (int i = 0; i < b->num_jobs; ++i) {
+        free(b->jobs[i].line);
+        free(b->jobs[i].text);
+    }
+    free(b->jobs);
+    pthread_mutex_destroy(&b->lock);
+    free(b);
+}
+
+void run_batch(batch* b, int threads)
+{
+    pthread_t workers[MAX_BATCH_THREADS];
+    int started = 0;
+    if (threads > b->num_jobs)
+        threads = b->num_jobs;
+    b->next_job = 0;
+    for (int i = 0; i < threads; ++i) {
+        if (pthread_create(&workers[started], NULL, batch_worker, b) == 0)
+            started += 1;
+    }
+    /* without any threads the jobs still have to run */
+    if (started == 0)
+        batch_worker(b);
+    for (int i = 0; i < started; ++i)
+        pthread_join(workers[i], NULL);
+}
+
+bool write_batch_results(batch* b, const char* path)
+{
+    if (path == NULL) {
+        write_csv(b, stdout);
+        return true;
+    }
+    size_t len = strlen(path);
+    bool json = len >= 5 && strcmp(path + len - 5, ".json") == 0;
+    FILE* file = fopen(path, "w");
+    if (! file)
+        return false;
+    if (json)
+        write_json(b, file);
+    else
+        write_csv(b, file);
+    return fclose(file) == 0;
+}
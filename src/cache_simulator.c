@@ -4,43 +4,245 @@
  * Last Updated: 6/4/17
  */
 #include "../include/cache_simulator.h"
+#include "../include/prefetcher.h"
+#include "../include/victim_cache.h"
+#include "../include/tenants.h"
+#include "../include/sectors.h"
+#include "../include/dueling.h"
 #include <stdbool.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
+#include <sys/resource.h>
 
 /* The size of addresses on this machine. */
 #define WORD_SIZE 64
 
-/* Return the number of the line that was least recently used. */
-line* lru(cache_simulator* cache, int set_index, int num_lines);
+/*
+ * Return the number of the line that was least recently used, out of the
+ * ways in mask. lines are the lines of the set, NULL for a skewed cache.
+ */
+line* lru(cache_simulator* cache, int set_index, uint64_t tag, line* lines,
+          uint64_t mask);
+
+/* Return a random line of the given set, out of the ways in mask. */
+static line* random_line(cache_simulator* cache, int set_index, uint64_t tag,
+                         uint64_t mask);
+
+/* Return the first line at a distant RRPV, ageing the set until one is. */
+static line* rrip_victim(cache_simulator* cache, int set_index, uint64_t tag,
+                         uint64_t mask);
+
+/* Place a line just filled in the replacement order of its set. */
+static void insert_line(cache_simulator* cache, int set_index, uint64_t tag,
+                        line* l);
+
+/*
+ * Find the line a new block for the given set should be placed in. Sets
+ * evicts if the returned line holds a valid block that must be replaced.
+ */
+static line* find_fill_line(cache_simulator* cache, int set_index,
+                            uint64_t tag, bool* evicts);
+
+/* Restore the OPT heap order of a set after the key of l changed. */
+static void opt_reorder(cache_simulator* cache, int set_index, line* l);
+
+/* Return the block address of the block held in a line of the given set. */
+static uint64_t line_block(cache_simulator* cache, line* l, int set_index);
+
+/* Return the set way w of a skewed cache uses for a block. */
+static unsigned skew_index(cache_simulator* cache, uint64_t block, int way);
+
+/* Return the smallest number of bits that can hold n distinct values. */
+static int bits_for(int n)
+{
+    int bits = 0;
+    while ((1 << bits) < n)
+        bits++;
+    return bits;
+}
+
+/* Return the largest prime that is not greater than n. */
+static int prime_below(int n)
+{
+    for (; n > 2; --n) {
+        bool prime = true;
+        for (int d = 2; d * d <= n && prime; ++d)
+            prime = n % d != 0;
+        if (prime)
+            return n;
+    }
+    return n;
+}
+
+/*
+ * Bimodal insertion inserts like the policy it duels once in this many
+ * fills.
+ */
+#define BIMODAL_THROTTLE 32
+
+/* Returns true if the policy replaces lines by their RRPV. */
+static inline bool is_rrip(replacement_policy policy)
+{
+    return policy == REPLACE_SRRIP || policy == REPLACE_DRRIP;
+}
+
+/* Returns true if way is one of the ways in mask. */
+static inline bool way_allowed(uint64_t mask, int way)
+{
+    return way >= MAX_MASK_WAYS || (mask >> way) & 1;
+}
+
+/*
+ * Return the lines of a set, allocating its page if create is set. Returns
+ * NULL for a set whose page was never allocated when create is not set.
+ */
+static inline line* set_lines(cache_simulator* cache, int set_index,
+                              bool create)
+{
+    line* page = cache->pages[set_index >> cache->page_bits];
+    if (page == NULL) {
+        if (! create)
+            return NULL;
+        page = get_page(cache, set_index >> cache->page_bits, true);
+    }
+    int set_in_page = set_index & ((1 << cache->page_bits) - 1);
+    return page + set_in_page * cache->lines_per_set;
+}
+
+/*
+ * Return way w of the lines that a block with the given tag and set may
+ * be stored in. Only a skewed cache looks outside the block's set.
+ */
+static inline line* way_line(cache_simulator* cache, int set_index,
+                             uint64_t tag, int way)
+{
+    if (cache->index_fn == INDEX_SKEWED)
+        set_index = skew_index(cache, tag, way);
+    return set_lines(cache, set_index, true) + way;
+}
+
+/*
+ * Like way_line, but returns NULL instead of allocating the line's page,
+ * for lookups that only need to know if a block is present.
+ */
+static inline line* peek_line(cache_simulator* cache, int set_index,
+                              uint64_t tag, int way)
+{
+    if (cache->index_fn == INDEX_SKEWED)
+        set_index = skew_index(cache, tag, way);
+    line* lines = set_lines(cache, set_index, false);
+    return lines ? lines + way : NULL;
+}
+
+/*
+ * Return the line holding the block with the given tag and set, setting
+ * way to its way, or NULL if the block is not cached. Never allocates.
+ */
+static inline line* lookup_line(cache_simulator* cache, int set_index,
+                                uint64_t tag, int* way)
+{
+    int lines_per_set = cache->lines_per_set;
+    if (cache->index_fn == INDEX_SKEWED) {
+        for (int i = 0; i < lines_per_set; ++i) {
+            line* curr = peek_line(cache, set_index, tag, i);
+            if (curr && curr->tag == tag && curr->valid_bit) {
+                *way = i;
+                return curr;
+            }
+        }
+        return NULL;
+    }
+    /* set_lines by hand, a lookup never allocates */
+    line* lines = cache->pages[set_index >> cache->page_bits];
+    if (lines == NULL)
+        return NULL;
+    lines += (set_index & ((1 << cache->page_bits) - 1)) * lines_per_set;
+    for (int i = 0; i < lines_per_set; ++i) {
+        if (lines[i].tag == tag && lines[i].valid_bit) {
+            *way = i;
+            return lines + i;
+        }
+    }
+    return NULL;
+}
 
 cache_simulator* build_simulator(int b, int s, int e)
 {
-    int total_num_lines = (1 << s) * e;
-    cache_simulator* cache = malloc(sizeof(cache_simulator));
+    if (s < 0 || s > MAX_SET_BITS)
+        return NULL;
+    return build_indexed_simulator(b, 1 << s, e, INDEX_BIT_SLICE);
+}
+
+cache_simulator* build_indexed_simulator(int b, int num_sets, int e,
+                                         index_function index_fn)
+{
+    size_t total_num_lines;
+    int s;
+    int page_bits = 0;
+    cache_simulator* cache;
+    if (num_sets <= 0 || num_sets > 1 << MAX_SET_BITS || e <= 0)
+        return NULL;
+    total_num_lines = (size_t) num_sets * e;
+    s = bits_for(num_sets);
+    cache = malloc(sizeof(cache_simulator));
     if (cache == NULL) {
         return NULL;
     }
-    line* lines = calloc(total_num_lines, sizeof(line));
-    if (lines == NULL) {
+    /* as many whole sets as fit in a page, but at least one */
+    while (((size_t) 2 << page_bits) * e * sizeof(line) <= SET_PAGE_BYTES
+            && (1 << page_bits) < num_sets)
+        page_bits++;
+    cache->num_pages = ((num_sets - 1) >> page_bits) + 1;
+    cache->pages = calloc(cache->num_pages, sizeof(line*));
+    if (cache->pages == NULL) {
         free(cache);
         return NULL;
     }
-    cache->lines = lines;
+    cache->page_bits = page_bits;
+    cache->page_lines = (1 << page_bits) * e;
+    cache->pages_allocated = 0;
     cache->lines_per_set = e;
     cache->hit_count = cache->miss_count = cache->eviction_count = 0;
     cache->tag_len = WORD_SIZE - (s + b);
     cache->offset_len = b;
     cache->index_len = s;
     cache->num_lines = total_num_lines;
+    cache->num_sets = num_sets;
+    cache->index_fn = index_fn;
+    cache->set_modulus = index_fn == INDEX_PRIME ? prime_below(num_sets)
+                                                 : num_sets;
+    cache->policy = REPLACE_LRU;
+    cache->rng_state = 0x9E3779B97F4A7C15ULL;
+    cache->next_use = 0;
+    cache->prefetcher = NULL;
+    cache->victim_cache = NULL;
+    cache->tenants = NULL;
+    cache->sectors = NULL;
+    cache->writing = false;
+    cache->dueling = NULL;
+    cache->last_victim = (line) {0};
+    cache->last_victim_block = 0;
     return cache;
 }
 
 void destroy_simulator(cache_simulator* cache)
 {
-    free(cache->lines);
+    if (cache->prefetcher)
+        destroy_prefetcher(cache->prefetcher);
+    if (cache->victim_cache)
+        destroy_victim_cache(cache->victim_cache);
+    if (cache->tenants)
+        destroy_tenant_table(cache->tenants);
+    if (cache->sectors)
+        destroy_sector_map(cache->sectors);
+    if (cache->dueling)
+        destroy_dueling(cache->dueling);
+    for (int i = 0; i < cache->num_pages; ++i)
+        free(cache->pages[i]);
+    free(cache->pages);
     free(cache);
 }
 
@@ -49,60 +251,480 @@ op_state check_cache(cache_simulator* cache, address_info* addr, int inst_no)
     // get state from the cache
     int lines_per_set = cache->lines_per_set;
     int set_index = addr->set_index;
-    unsigned tag = addr->tag;
-    
-    // a line pointer to store the first open line we find
-    line* open_line = NULL;
-    line* curr_line = &(cache->lines[set_index * lines_per_set]);
-
-    // iterate through each line looking for a cache hit
-    for (int i = 0; i < lines_per_set; ++i, curr_line++) {
-        bool equal_tags = curr_line->tag == tag;
-        bool valid_line = curr_line->valid_bit;
-        if (equal_tags && valid_line) {
-            /* cache hit */
-            curr_line->tag = tag;
+    uint64_t tag = addr->tag;
+    prefetcher* pf = cache->prefetcher;
+    op_state result = CACHE_MISS;
+    bool evicts, first_use = false, sector_miss = false;
+    line* curr_line;
+    int way;
+
+    /* land any prefetches that have arrived by now */
+    if (pf != NULL)
+        prefetch_drain(pf, cache, inst_no);
+    if (cache->dueling)
+        dueling_access(cache->dueling);
+
+    // look through the lines of the set for a cache hit
+    curr_line = NULL;
+    if (cache->index_fn == INDEX_SKEWED) {
+        curr_line = lookup_line(cache, set_index, tag, &way);
+    } else if (cache->pages[set_index >> cache->page_bits] != NULL) {
+        /* lookup_line by hand, the common case of every access */
+        line* lines = cache->pages[set_index >> cache->page_bits]
+                      + (set_index & ((1 << cache->page_bits) - 1))
+                        * lines_per_set;
+        for (way = 0; way < lines_per_set; ++way) {
+            if (lines[way].tag == tag && lines[way].valid_bit) {
+                curr_line = lines + way;
+                break;
+            }
+        }
+    }
+    if (curr_line != NULL) {
+        if (cache->policy == REPLACE_LRU || cache->policy == REPLACE_DIP)
             curr_line->last_instruction = inst_no;
+        else if (is_rrip(cache->policy))
+            curr_line->rrpv = RRPV_NEAR;
+        /* the block is here but the sector may not be */
+        if (cache->sectors && ! sector_access(cache->sectors, set_index,
+                    way, addr->offset, cache->writing)) {
+            cache->miss_count += 1;
+            if (cache->tenants)
+                cache->tenants->stats[cache->tenants->current].misses += 1;
+            sector_miss = true;
+        } else {
+            /* cache hit */
             cache->hit_count += 1;
-            return CACHE_HIT;
-        } else if (! valid_line && open_line == NULL)
-            /* remember the index of an open line */
-            open_line = curr_line;
-    }
-    /* cache miss */
-    cache->miss_count += 1;
-
-    /* updated the open line we found if we found one */
-    if (open_line != NULL) {
-        open_line->tag = tag;
-        open_line->valid_bit = true;
-        open_line->last_instruction = inst_no;
-    } else {
-        /* otherwise we have to replace an existing line */
-        cache->eviction_count += 1;
-        line* line_to_replace = lru(cache, set_index, lines_per_set);
-        //update_line(line_to_replace, tag, inst_no);
-        line_to_replace->tag = tag;
-        line_to_replace->last_instruction = inst_no;
-        return CACHE_EVICTION;
-    }
-    return CACHE_MISS;
-}
-
-line* lru(cache_simulator* cache, int set_index, int num_lines)
-{
-    int line_no = set_index * num_lines;
-    line* curr = &(cache->lines[line_no]);
-    int smallest = curr->last_instruction;
-    line* result = curr;
-    curr++;
-    for (int i = 1; i < num_lines; ++i) {
+            if (cache->tenants)
+                cache->tenants->stats[cache->tenants->current].hits += 1;
+            if (curr_line->prefetched) {
+                curr_line->prefetched = false;
+                first_use = true;
+                if (pf != NULL)
+                    pf->useful += 1;
+            }
+            result = CACHE_HIT;
+            if (cache->policy == REPLACE_OPT) {
+                curr_line->last_instruction = cache->next_use;
+                opt_reorder(cache, set_index, curr_line);
+            }
+        }
+    }
+
+    if (result != CACHE_HIT && ! sector_miss) {
+        /* cache miss */
+        cache->miss_count += 1;
+        if (cache->tenants)
+            cache->tenants->stats[cache->tenants->current].misses += 1;
+        if (pf != NULL)
+            prefetch_demand_miss(pf, get_block_address(cache, addr));
+        if (cache->victim_cache != NULL)
+            victim_probe(cache->victim_cache, get_block_address(cache, addr));
+        if (cache->dueling)
+            dueling_miss(cache->dueling, set_index);
+
+        /* use an open line if there is one, otherwise replace a line */
+        curr_line = find_fill_line(cache, set_index, tag, &evicts);
+        if (evicts) {
+            cache->eviction_count += 1;
+            result = CACHE_EVICTION;
+            cache->last_victim = *curr_line;
+            cache->last_victim_block = line_block(cache, curr_line, set_index);
+            if (cache->victim_cache != NULL)
+                victim_insert(cache->victim_cache, cache->last_victim_block);
+            if (cache->tenants)
+                cache->tenants->stats[cache->tenants->current].evictions += 1;
+        }
+        if (cache->tenants) {
+            tenant_fill(cache->tenants, evicts, curr_line->owner);
+            curr_line->owner = cache->tenants->current;
+        }
+        if (cache->sectors)
+            sector_fill(cache->sectors, set_index,
+                        curr_line - set_lines(cache, set_index, true),
+                        addr->offset, cache->writing, evicts, false);
+        curr_line->tag = tag;
+        curr_line->valid_bit = true;
+        curr_line->prefetched = false;
+        curr_line->state = 0;
+        curr_line->last_instruction = inst_no;
+        /* only SRRIP and the dueling policies insert anywhere else */
+        if (cache->dueling || cache->policy == REPLACE_SRRIP)
+            insert_line(cache, set_index, tag, curr_line);
+        if (cache->policy == REPLACE_OPT) {
+            curr_line->last_instruction = cache->next_use;
+            opt_reorder(cache, set_index, curr_line);
+        }
+    }
+
+    if (pf != NULL)
+        prefetch_observe(pf, cache, get_block_address(cache, addr),
+                         result != CACHE_HIT || first_use);
+    return result;
+}
+
+bool prefetch_fill(cache_simulator* cache, uint64_t block, int inst_no,
+                   uint64_t* victim)
+{
+    address_info addr;
+    bool evicts;
+    if (contains_block(cache, block))
+        return false;
+    get_address_info(block << cache->offset_len, &addr, cache);
+    line* fill = find_fill_line(cache, addr.set_index, addr.tag, &evicts);
+    if (evicts) {
+        *victim = line_block(cache, fill, addr.set_index);
+        if (cache->victim_cache != NULL)
+            victim_insert(cache->victim_cache, *victim);
+    }
+    if (cache->tenants) {
+        tenant_fill(cache->tenants, evicts, fill->owner);
+        fill->owner = cache->tenants->current;
+    }
+    if (cache->sectors)
+        sector_fill(cache->sectors, addr.set_index,
+                    fill - set_lines(cache, addr.set_index, true), 0, false,
+                    evicts, true);
+    fill->tag = addr.tag;
+    fill->valid_bit = true;
+    fill->prefetched = true;
+    fill->state = 0;
+    fill->last_instruction = inst_no;
+    fill->rrpv = RRPV_LONG;
+    return true;
+}
+
+bool contains_block(cache_simulator* cache, uint64_t block)
+{
+    return find_block(cache, block) != NULL;
+}
+
+line* find_block(cache_simulator* cache, uint64_t block)
+{
+    address_info addr;
+    int way;
+    get_address_info(block << cache->offset_len, &addr, cache);
+    return lookup_line(cache, addr.set_index, addr.tag, &way);
+}
+
+void touch_block(cache_simulator* cache, address_info* addr, int inst_no)
+{
+    int way;
+    if (cache->dueling)
+        dueling_access(cache->dueling);
+    line* l = lookup_line(cache, addr->set_index, addr->tag, &way);
+    if (l == NULL)
+        return;
+    if (cache->policy == REPLACE_LRU || cache->policy == REPLACE_DIP)
+        l->last_instruction = inst_no;
+    else if (is_rrip(cache->policy))
+        l->rrpv = RRPV_NEAR;
+}
+
+bool invalidate_block(cache_simulator* cache, uint64_t block)
+{
+    line* l = find_block(cache, block);
+    if (l == NULL)
+        return false;
+    if (cache->tenants)
+        tenant_release(cache->tenants, l->owner);
+    l->valid_bit = false;
+    l->prefetched = false;
+    l->state = 0;
+    return true;
+}
+
+static line* find_fill_line(cache_simulator* cache, int set_index,
+                            uint64_t tag, bool* evicts)
+{
+    /* the top of the heap is an empty line, or the one used furthest out */
+    if (cache->policy == REPLACE_OPT) {
+        line* top = way_line(cache, set_index, tag, 0);
+        *evicts = top->valid_bit;
+        return top;
+    }
+    /* a tenant may only fill the ways it was given */
+    uint64_t mask = cache->tenants ? tenant_way_mask(cache->tenants) : ~0ULL;
+    /* without skewing every way is in one set, which is walked directly */
+    line* lines = cache->index_fn == INDEX_SKEWED
+                  ? NULL : set_lines(cache, set_index, true);
+    for (int i = 0; i < cache->lines_per_set; ++i) {
+        line* curr_line = lines ? lines + i
+                                : way_line(cache, set_index, tag, i);
+        if (! curr_line->valid_bit && way_allowed(mask, i)) {
+            *evicts = false;
+            return curr_line;
+        }
+    }
+    *evicts = true;
+    if (cache->policy == REPLACE_RANDOM)
+        return random_line(cache, set_index, tag, mask);
+    if (is_rrip(cache->policy))
+        return rrip_victim(cache, set_index, tag, mask);
+    return lru(cache, set_index, tag, lines, mask);
+}
+
+/* Return the next number of the cache's xorshift64 generator. */
+static uint64_t next_random(cache_simulator* cache)
+{
+    uint64_t x = cache->rng_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    cache->rng_state = x;
+    return x;
+}
+
+static line* random_line(cache_simulator* cache, int set_index, uint64_t tag,
+                         uint64_t mask)
+{
+    int allowed = 0, way = 0;
+    uint64_t x = next_random(cache);
+
+    /* pick uniformly among the allowed ways */
+    for (int i = 0; i < cache->lines_per_set; ++i)
+        allowed += way_allowed(mask, i);
+    for (int pick = x % allowed; ; ++way) {
+        if (way_allowed(mask, way) && pick-- == 0)
+            break;
+    }
+    return way_line(cache, set_index, tag, way);
+}
+
+static uint64_t line_block(cache_simulator* cache, line* l, int set_index)
+{
+    if (cache->index_fn != INDEX_BIT_SLICE)
+        return l->tag;
+    return (l->tag << cache->index_len) | set_index;
+}
+
+line* lru(cache_simulator* cache, int set_index, uint64_t tag, line* lines,
+          uint64_t mask)
+{
+    line* result = NULL;
+    int smallest = 0;
+    for (int i = 0; i < cache->lines_per_set; ++i) {
+        if (mask != ~0ULL && ! way_allowed(mask, i))
+            continue;
+        line* curr = lines ? lines + i : way_line(cache, set_index, tag, i);
         int curr_value = curr->last_instruction;
-        if (curr_value < smallest) {
+        if (result == NULL || curr_value < smallest) {
             smallest = curr_value;
             result = curr;
         }
-        curr++;
     }
     return result;
-}
\ No newline at end of file
+}
+
+static line* rrip_victim(cache_simulator* cache, int set_index, uint64_t tag,
+                         uint64_t mask)
+{
+    for (;;) {
+        for (int i = 0; i < cache->lines_per_set; ++i) {
+            line* curr = way_line(cache, set_index, tag, i);
+            if (way_allowed(mask, i) && curr->rrpv == RRPV_DISTANT)
+                return curr;
+        }
+        for (int i = 0; i < cache->lines_per_set; ++i) {
+            if (way_allowed(mask, i))
+                way_line(cache, set_index, tag, i)->rrpv += 1;
+        }
+    }
+}
+
+static void insert_line(cache_simulator* cache, int set_index, uint64_t tag,
+                        line* l)
+{
+    if (cache->policy != REPLACE_DIP && ! is_rrip(cache->policy))
+        return;
+    /* SRRIP, and the first policy of each duel, insert as usual */
+    int policy = cache->dueling ? dueling_choice(cache->dueling, set_index)
+                                : 0;
+    bool bimodal = policy == 1
+                   && next_random(cache) % BIMODAL_THROTTLE != 0;
+    if (is_rrip(cache->policy)) {
+        l->rrpv = bimodal ? RRPV_DISTANT : RRPV_LONG;
+        return;
+    }
+    if (! bimodal)
+        return;
+    /* below every other line of the set, so it is replaced next */
+    int oldest = l->last_instruction;
+    for (int i = 0; i < cache->lines_per_set; ++i) {
+        line* curr = way_line(cache, set_index, tag, i);
+        if (curr != l && curr->valid_bit
+                && curr->last_instruction < oldest)
+            oldest = curr->last_instruction;
+    }
+    l->last_instruction = oldest - 1;
+}
+
+/* The key a set's OPT heap is ordered on, empty lines come first. */
+static inline int opt_key(line* l)
+{
+    return l->valid_bit ? l->last_instruction : INT32_MAX;
+}
+
+static void opt_reorder(cache_simulator* cache, int set_index, line* l)
+{
+    line* heap = set_lines(cache, set_index, true);
+    int n = cache->lines_per_set;
+    int i = l - heap;
+    line moved;
+
+    /* sift up while the parent is used sooner */
+    while (i > 0 && opt_key(&heap[(i - 1) / 2]) < opt_key(&heap[i])) {
+        moved = heap[i];
+        heap[i] = heap[(i - 1) / 2];
+        heap[(i - 1) / 2] = moved;
+        i = (i - 1) / 2;
+    }
+    /* sift down while a child is used later */
+    for (;;) {
+        int largest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < n && opt_key(&heap[left]) > opt_key(&heap[largest]))
+            largest = left;
+        if (right < n && opt_key(&heap[right]) > opt_key(&heap[largest]))
+            largest = right;
+        if (largest == i)
+            break;
+        moved = heap[i];
+        heap[i] = heap[largest];
+        heap[largest] = moved;
+        i = largest;
+    }
+}
+
+static unsigned skew_index(cache_simulator* cache, uint64_t block, int way)
+{
+    /* mix the block address with a different constant for each way */
+    uint64_t x = block + (way + 1) * 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x % cache->num_sets;
+}
+
+bool parse_replacement_policy(const char* name, replacement_policy* policy)
+{
+    if (strcmp(name, "lru") == 0)
+        *policy = REPLACE_LRU;
+    else if (strcmp(name, "fifo") == 0)
+        *policy = REPLACE_FIFO;
+    else if (strcmp(name, "random") == 0)
+        *policy = REPLACE_RANDOM;
+    else if (strcmp(name, "opt") == 0)
+        *policy = REPLACE_OPT;
+    else if (strcmp(name, "srrip") == 0)
+        *policy = REPLACE_SRRIP;
+    else if (strcmp(name, "dip") == 0)
+        *policy = REPLACE_DIP;
+    else if (strcmp(name, "drrip") == 0)
+        *policy = REPLACE_DRRIP;
+    else
+        return false;
+    return true;
+}
+
+bool set_replacement_policy(cache_simulator* cache, replacement_policy policy)
+{
+    cache->policy = policy;
+    if (cache->dueling) {
+        destroy_dueling(cache->dueling);
+        cache->dueling = NULL;
+    }
+    if (policy == REPLACE_DIP)
+        cache->dueling = build_dueling(cache->num_sets, "lru", "bip");
+    else if (policy == REPLACE_DRRIP)
+        cache->dueling = build_dueling(cache->num_sets, "srrip", "brrip");
+    else
+        return true;
+    return cache->dueling != NULL;
+}
+
+bool parse_index_function(const char* name, index_function* index_fn)
+{
+    if (strcmp(name, "slice") == 0)
+        *index_fn = INDEX_BIT_SLICE;
+    else if (strcmp(name, "mod") == 0)
+        *index_fn = INDEX_MODULO;
+    else if (strcmp(name, "xor") == 0)
+        *index_fn = INDEX_XOR;
+    else if (strcmp(name, "prime") == 0)
+        *index_fn = INDEX_PRIME;
+    else if (strcmp(name, "skew") == 0)
+        *index_fn = INDEX_SKEWED;
+    else
+        return false;
+    return true;
+}
+
+void get_address_info(uint64_t address, address_info* addr,
+        cache_simulator* cache)
+{
+    int offset_len = cache->offset_len;
+    int index_len = cache->index_len;
+    uint64_t block = address >> offset_len;
+    uint64_t folded = 0;
+
+    /* Get the byte offset bits from address */
+    addr->offset = address & ((1ULL << offset_len) - 1);
+    if (cache->index_fn == INDEX_BIT_SLICE) {
+        /* Get the tag bits from address */
+        addr->tag = (block >> index_len) & LINE_TAG_MASK;
+        /* Get the set index bits from address */
+        addr->set_index = block & ((1ULL << index_len) - 1);
+        return;
+    }
+
+    /* Other index functions keep the whole block address as the tag */
+    addr->tag = block & LINE_TAG_MASK;
+    switch (cache->index_fn) {
+        case INDEX_XOR:
+            for (; index_len > 0 && block != 0; block >>= index_len)
+                folded ^= block & ((1ULL << index_len) - 1);
+            addr->set_index = folded % cache->num_sets;
+            break;
+        case INDEX_SKEWED:
+            /* the set of the first way, the others are found by way_line */
+            addr->set_index = skew_index(cache, addr->tag, 0);
+            break;
+        default:
+            addr->set_index = block % cache->set_modulus;
+            break;
+    }
+}
+
+uint64_t get_block_address(cache_simulator* cache, address_info* addr)
+{
+    if (cache->index_fn != INDEX_BIT_SLICE)
+        return addr->tag;
+    return (addr->tag << cache->index_len) | addr->set_index;
+}
+
+line* get_page(cache_simulator* cache, int page, bool create)
+{
+    if (cache->pages[page] == NULL && create) {
+        cache->pages[page] = calloc(cache->page_lines, sizeof(line));
+        if (cache->pages[page] == NULL) {
+            printf("Unable to allocate memory for "
+                   "cache lines -- aborting.\n\n");
+            exit(EXIT_FAILURE);
+        }
+        cache->pages_allocated += 1;
+    }
+    return cache->pages[page];
+}
+
+void print_memory_summary(cache_simulator* cache)
+{
+    struct rusage usage;
+    size_t page_bytes = cache->page_lines * sizeof(line);
+    size_t resident = cache->pages_allocated * page_bytes
+                      + cache->num_pages * sizeof(line*);
+    size_t dense = cache->num_lines * sizeof(line);
+    long max_rss = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+    printf("memory pages:%d/%d line-bytes:%zu dense-line-bytes:%zu"
+           " max-rss-kb:%ld\n", cache->pages_allocated, cache->num_pages,
+           resident, dense, max_rss);
+}
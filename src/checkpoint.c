@@ -0,0 +1,169 @@
+/*
+ * checkpoint.c
+ * Saving and restoring cache simulator state.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "../include/checkpoint.h"
+#include "../include/cache_simulator.h"
+#include "../include/dueling.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+bool save_checkpoint(cache_simulator* cache, trace_position* position,
+                     const char* path)
+{
+    checkpoint_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.line_size = sizeof(line);
+    header.offset_len = cache->offset_len;
+    header.num_sets = cache->num_sets;
+    header.lines_per_set = cache->lines_per_set;
+    header.index_fn = cache->index_fn;
+    header.policy = cache->policy;
+    header.hit_count = cache->hit_count;
+    header.miss_count = cache->miss_count;
+    header.eviction_count = cache->eviction_count;
+    header.rng_state = cache->rng_state;
+    header.position = *position;
+    header.page_lines = cache->page_lines;
+    header.saved_pages = cache->pages_allocated;
+    dueling* d = cache->dueling;
+    if (d != NULL) {
+        header.psel = d->psel;
+        header.dueling_runs = d->num_runs;
+        header.dueling_accesses = d->accesses;
+        for (int i = 0; i < 2; ++i) {
+            header.leader_misses[i] = d->leader_misses[i];
+            header.follower_fills[i] = d->follower_fills[i];
+        }
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (! file)
+        return false;
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+    /* only the pages in use, sets never touched restore as empty */
+    for (int64_t page = 0; page < cache->num_pages && written; ++page) {
+        line* lines = get_page(cache, page, false);
+        if (lines == NULL)
+            continue;
+        written = fwrite(&page, sizeof(page), 1, file) == 1
+            && fwrite(lines, sizeof(line), cache->page_lines, file)
+               == (size_t) cache->page_lines;
+    }
+    if (d != NULL && written)
+        written = fwrite(d->runs, sizeof(dueling_run), d->num_runs, file)
+                  == (size_t) d->num_runs;
+    return fclose(file) == 0 && written;
+}
+
+/* Restore the set dueling saved in header, with its runs at saved. */
+static bool restore_dueling(dueling* d, checkpoint_header* header,
+                            char* saved)
+{
+    d->psel = header->psel;
+    d->accesses = header->dueling_accesses;
+    for (int i = 0; i < 2; ++i) {
+        d->leader_misses[i] = header->leader_misses[i];
+        d->follower_fills[i] = header->follower_fills[i];
+    }
+    if (header->dueling_runs == 0)
+        return true;
+    d->runs = malloc(header->dueling_runs * sizeof(dueling_run));
+    if (d->runs == NULL)
+        return false;
+    memcpy(d->runs, saved, header->dueling_runs * sizeof(dueling_run));
+    d->num_runs = d->runs_capacity = header->dueling_runs;
+    return true;
+}
+
+cache_simulator* load_checkpoint(const char* path, trace_position* position)
+{
+    struct stat st;
+    cache_simulator* cache = NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        printf("ERROR: Failed to open checkpoint: %s\n", path);
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    if ((size_t) st.st_size < sizeof(checkpoint_header)) {
+        printf("ERROR: %s is not a checkpoint\n", path);
+        close(fd);
+        return NULL;
+    }
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("ERROR: Failed to map checkpoint: %s\n", path);
+        return NULL;
+    }
+
+    checkpoint_header* header = data;
+    size_t page_size = sizeof(int64_t) + header->page_lines * sizeof(line);
+    if (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0
+            || header->version != CHECKPOINT_VERSION
+            || header->line_size != sizeof(line)
+            || header->dueling_runs < 0
+            || (size_t) st.st_size
+               != sizeof(checkpoint_header)
+                  + header->saved_pages * page_size
+                  + header->dueling_runs * sizeof(dueling_run)) {
+        printf("ERROR: %s is not a version %d checkpoint\n", path,
+               CHECKPOINT_VERSION);
+        munmap(data, st.st_size);
+        return NULL;
+    }
+
+    cache = build_indexed_simulator(header->offset_len, header->num_sets,
+            header->lines_per_set, (index_function) header->index_fn);
+    if (cache != NULL && cache->page_lines != header->page_lines) {
+        printf("ERROR: %s pages its sets differently\n", path);
+        destroy_simulator(cache);
+        cache = NULL;
+    }
+    if (cache != NULL) {
+        char* saved = (char*) (header + 1);
+        for (int64_t i = 0; i < header->saved_pages; ++i) {
+            int64_t page;
+            memcpy(&page, saved, sizeof(page));
+            if (page < 0 || page >= cache->num_pages) {
+                printf("ERROR: %s is not a version %d checkpoint\n", path,
+                       CHECKPOINT_VERSION);
+                destroy_simulator(cache);
+                munmap(data, st.st_size);
+                return NULL;
+            }
+            memcpy(get_page(cache, page, true), saved + sizeof(page),
+                   cache->page_lines * sizeof(line));
+            saved += page_size;
+        }
+        if (! set_replacement_policy(cache,
+                (replacement_policy) header->policy)
+                || (cache->dueling && ! restore_dueling(cache->dueling,
+                                                        header, saved))) {
+            printf("Unable to allocate memory for "
+                   "cache simulator -- aborting.\n\n");
+            destroy_simulator(cache);
+            munmap(data, st.st_size);
+            return NULL;
+        }
+        cache->hit_count = header->hit_count;
+        cache->miss_count = header->miss_count;
+        cache->eviction_count = header->eviction_count;
+        cache->rng_state = header->rng_state;
+        *position = header->position;
+    }
+    munmap(data, st.st_size);
+    return cache;
+}
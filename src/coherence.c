@@ -0,0 +1,190 @@
+/*
+ * coherence.c
+ * Private caches kept coherent by snooping MESI or MOESI.
+ */
+#include "../include/coherence.h"
+#include "../include/cache_simulator.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* Invalidate every copy of block other than the one held by core. */
+static void invalidate_others(coherent_system* sys, int core, uint64_t block);
+
+/* The slot in the invalidation filter for a block. */
+static int filter_slot(uint64_t block)
+{
+    return (block ^ (block >> 12)) % INVALIDATION_FILTER;
+}
+
+/* Returns true if a core holding a block in this state supplies misses. */
+static bool supplies(coherence_state state)
+{
+    return state == STATE_MODIFIED || state == STATE_OWNED
+        || state == STATE_EXCLUSIVE;
+}
+
+coherent_system* build_coherent_system(int num_cores, int b, int s, int E,
+                                       int shared_s, int shared_E,
+                                       coherence_protocol protocol)
+{
+    coherent_system* sys = calloc(1, sizeof(coherent_system));
+    if (sys == NULL)
+        return NULL;
+    sys->protocol = protocol;
+    for (int i = 0; i < num_cores; ++i) {
+        sys->cores[i] = build_simulator(b, s, E);
+        sys->invalidated[i] = calloc(INVALIDATION_FILTER, sizeof(uint64_t));
+        if (sys->cores[i] == NULL || sys->invalidated[i] == NULL) {
+            if (sys->cores[i])
+                destroy_simulator(sys->cores[i]);
+            free(sys->invalidated[i]);
+            destroy_coherent_system(sys);
+            return NULL;
+        }
+        sys->num_cores += 1;
+    }
+    if (shared_s > 0) {
+        sys->shared = build_simulator(b, shared_s, shared_E);
+        if (sys->shared == NULL) {
+            destroy_coherent_system(sys);
+            return NULL;
+        }
+    }
+    return sys;
+}
+
+void destroy_coherent_system(coherent_system* sys)
+{
+    for (int i = 0; i < sys->num_cores; ++i) {
+        destroy_simulator(sys->cores[i]);
+        free(sys->invalidated[i]);
+    }
+    if (sys->shared)
+        destroy_simulator(sys->shared);
+    free(sys);
+}
+
+bool parse_coherence_protocol(const char* name, coherence_protocol* protocol)
+{
+    if (strcmp(name, "mesi") == 0)
+        *protocol = PROTOCOL_MESI;
+    else if (strcmp(name, "moesi") == 0)
+        *protocol = PROTOCOL_MOESI;
+    else
+        return false;
+    return true;
+}
+
+op_state coherent_access(coherent_system* sys, int core, uint64_t address,
+                         bool write, int inst_no)
+{
+    cache_simulator* own = sys->cores[core];
+    core_stats* stats = &sys->stats[core];
+    address_info addr;
+    op_state result;
+    bool supplied = false, shared_copy = false;
+
+    get_address_info(address, &addr, own);
+    uint64_t block = get_block_address(own, &addr);
+    line* l = find_block(own, block);
+
+    if (l != NULL) {
+        /* a hit, but a write must first own the only copy */
+        result = check_cache(own, &addr, inst_no);
+        if (write) {
+            if (l->state == STATE_SHARED || l->state == STATE_OWNED) {
+                stats->upgrades += 1;
+                invalidate_others(sys, core, block);
+            }
+            l->state = STATE_MODIFIED;
+        }
+        return result;
+    }
+
+    /* a miss, was the block taken from us by another core? */
+    int slot = filter_slot(block);
+    if (sys->invalidated[core][slot] == block + 1) {
+        stats->coherence_misses += 1;
+        sys->invalidated[core][slot] = 0;
+    }
+
+    /* snoop the other cores */
+    for (int p = 0; p < sys->num_cores; ++p) {
+        line* peer = p == core ? NULL : find_block(sys->cores[p], block);
+        if (peer == NULL)
+            continue;
+        if (! supplied && supplies(peer->state)) {
+            sys->stats[p].transfers_sent += 1;
+            stats->transfers_received += 1;
+            supplied = true;
+        }
+        if (write)
+            continue;
+        /* a read leaves the other copies shared */
+        shared_copy = true;
+        if (peer->state == STATE_MODIFIED) {
+            if (sys->protocol == PROTOCOL_MOESI) {
+                peer->state = STATE_OWNED;
+            } else {
+                peer->state = STATE_SHARED;
+                sys->stats[p].writebacks += 1;
+            }
+        } else if (peer->state == STATE_EXCLUSIVE) {
+            peer->state = STATE_SHARED;
+        }
+    }
+    if (write)
+        invalidate_others(sys, core, block);
+
+    /* no core could supply the block, so it comes from the next level */
+    if (! supplied && sys->shared != NULL) {
+        address_info shared_addr;
+        get_address_info(address, &shared_addr, sys->shared);
+        check_cache(sys->shared, &shared_addr, inst_no);
+    }
+
+    result = check_cache(own, &addr, inst_no);
+    if (result == CACHE_EVICTION && (own->last_victim.state == STATE_MODIFIED
+            || own->last_victim.state == STATE_OWNED))
+        stats->writebacks += 1;
+    l = find_block(own, block);
+    if (write)
+        l->state = STATE_MODIFIED;
+    else
+        l->state = shared_copy ? STATE_SHARED : STATE_EXCLUSIVE;
+    return result;
+}
+
+void print_coherence_summary(coherent_system* sys)
+{
+    for (int i = 0; i < sys->num_cores; ++i) {
+        cache_simulator* c = sys->cores[i];
+        core_stats* st = &sys->stats[i];
+        printf("core %d hits:%d misses:%d evictions:%d coherence-misses:%lu"
+               " upgrades:%lu invalidations-sent:%lu"
+               " invalidations-received:%lu transfers-sent:%lu"
+               " transfers-received:%lu writebacks:%lu\n",
+               i, c->hit_count, c->miss_count, c->eviction_count,
+               st->coherence_misses, st->upgrades, st->invalidations_sent,
+               st->invalidations_received, st->transfers_sent,
+               st->transfers_received, st->writebacks);
+    }
+    if (sys->shared)
+        printf("shared hits:%d misses:%d evictions:%d\n",
+               sys->shared->hit_count, sys->shared->miss_count,
+               sys->shared->eviction_count);
+}
+
+static void invalidate_others(coherent_system* sys, int core, uint64_t block)
+{
+    for (int p = 0; p < sys->num_cores; ++p) {
+        if (p == core || ! invalidate_block(sys->cores[p], block))
+            continue;
+        sys->stats[core].invalidations_sent += 1;
+        sys->stats[p].invalidations_received += 1;
+        sys->invalidated[p][filter_slot(block)] = block + 1;
+    }
+}
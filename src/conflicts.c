@@ -0,0 +1,360 @@
+/*
+ * conflicts.c
+ * Conflict hot spots and the padding that removes them.
+ */
+#include "../include/conflicts.h"
+#include "../include/cache_simulator.h"
+#include "../include/instruction_reader.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* The conflicts printed, ranked by evictions. */
+#define MAX_CONFLICT_REPORT 10
+
+/* A pair along with the arrays its regions belong to, for clustering. */
+typedef struct {
+    int first, second;
+    conflict_pair* pair;
+} clustered_pair;
+
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+    while (b != 0) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* Return the slot of the pair of regions, or the empty slot it belongs in. */
+static size_t pair_slot(conflict_pair* pairs, size_t capacity,
+                        uint64_t first, uint64_t second)
+{
+    uint64_t key = first * 0x9E3779B97F4A7C15ULL ^ second;
+    size_t slot = (key * 0x9E3779B97F4A7C15ULL) & (capacity - 1);
+    while (pairs[slot].evictions != 0 && (pairs[slot].first != first
+                                          || pairs[slot].second != second))
+        slot = (slot + 1) & (capacity - 1);
+    return slot;
+}
+
+/* Grow the map of pairs to twice its size. Returns false if memory ran out. */
+static bool grow_pairs(conflict_analyzer* ca)
+{
+    size_t capacity = ca->capacity * 2;
+    conflict_pair* pairs = calloc(capacity, sizeof(conflict_pair));
+    if (pairs == NULL)
+        return false;
+    for (size_t i = 0; i < ca->capacity; ++i) {
+        conflict_pair* p = &ca->pairs[i];
+        if (p->evictions != 0)
+            pairs[pair_slot(pairs, capacity, p->first, p->second)] = *p;
+    }
+    free(ca->pairs);
+    ca->pairs = pairs;
+    ca->capacity = capacity;
+    return true;
+}
+
+conflict_analyzer* build_conflict_analyzer(int region_bits)
+{
+    conflict_analyzer* ca = calloc(1, sizeof(conflict_analyzer));
+    if (ca == NULL)
+        return NULL;
+    ca->region_bits = region_bits;
+    ca->capacity = 1024;
+    ca->pairs = calloc(ca->capacity, sizeof(conflict_pair));
+    ca->baseline_misses = -1;
+    if (ca->pairs == NULL) {
+        free(ca);
+        return NULL;
+    }
+    return ca;
+}
+
+void destroy_conflict_analyzer(conflict_analyzer* ca)
+{
+    free(ca->pairs);
+    free(ca->conflicts);
+    free(ca);
+}
+
+bool conflict_record(conflict_analyzer* ca, uint64_t address,
+                     uint64_t victim, int set)
+{
+    uint64_t first = address >> ca->region_bits;
+    uint64_t second = victim >> ca->region_bits;
+    if (first > second) {
+        uint64_t t = first;
+        first = second;
+        second = t;
+    }
+    conflict_pair* p = &ca->pairs[pair_slot(ca->pairs, ca->capacity,
+                                            first, second)];
+    if (p->evictions == 0) {
+        p->first = first;
+        p->second = second;
+        ca->size += 1;
+    }
+    p->evictions += 1;
+    p->distance = gcd(p->distance, address > victim ? address - victim
+                                                    : victim - address);
+    p->sets |= 1ULL << (set % 64);
+    ca->evictions += 1;
+    return ca->size * 2 <= ca->capacity || grow_pairs(ca);
+}
+
+static int compare_regions(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return x < y ? -1 : x > y;
+}
+
+static int compare_clustered(const void* a, const void* b)
+{
+    const clustered_pair* x = a;
+    const clustered_pair* y = b;
+    if (x->first != y->first)
+        return x->first - y->first;
+    return x->second - y->second;
+}
+
+/* Rank conflicts by their evictions, most first. */
+static int compare_conflicts(const void* a, const void* b)
+{
+    const conflict* x = a;
+    const conflict* y = b;
+    return x->evictions < y->evictions ? 1 : x->evictions > y->evictions
+                                             ? -1 : 0;
+}
+
+/* Return the array holding region, given the first region of each array. */
+static int find_array(uint64_t* starts, int num_arrays, uint64_t region)
+{
+    int lo = 0, hi = num_arrays - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (starts[mid] <= region)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+/*
+ * Fold the pairs into conflicts between arrays, runs of regions that are
+ * next to each other. Returns false if memory ran out.
+ */
+static bool cluster_pairs(conflict_analyzer* ca)
+{
+    uint64_t* regions = malloc((ca->size * 2 + 1) * sizeof(uint64_t));
+    uint64_t* starts = malloc((ca->size * 2 + 1) * sizeof(uint64_t));
+    uint64_t* ends = malloc((ca->size * 2 + 1) * sizeof(uint64_t));
+    clustered_pair* clustered = malloc((ca->size + 1)
+                                       * sizeof(clustered_pair));
+    ca->conflicts = malloc((ca->size + 1) * sizeof(conflict));
+    if (! regions || ! starts || ! ends || ! clustered || ! ca->conflicts) {
+        free(regions);
+        free(starts);
+        free(ends);
+        free(clustered);
+        return false;
+    }
+
+    /* the arrays are the runs of neighbouring regions */
+    size_t n = 0;
+    for (size_t i = 0; i < ca->capacity; ++i) {
+        if (ca->pairs[i].evictions != 0) {
+            regions[n++] = ca->pairs[i].first;
+            regions[n++] = ca->pairs[i].second;
+        }
+    }
+    qsort(regions, n, sizeof(uint64_t), compare_regions);
+    ca->num_arrays = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (ca->num_arrays > 0 && regions[i] <= ends[ca->num_arrays - 1] + 1) {
+            ends[ca->num_arrays - 1] = regions[i];
+        } else {
+            starts[ca->num_arrays] = ends[ca->num_arrays] = regions[i];
+            ca->num_arrays += 1;
+        }
+    }
+
+    /* then the pairs between the same arrays become one conflict */
+    n = 0;
+    for (size_t i = 0; i < ca->capacity; ++i) {
+        conflict_pair* p = &ca->pairs[i];
+        if (p->evictions == 0)
+            continue;
+        clustered[n].first = find_array(starts, ca->num_arrays, p->first);
+        clustered[n].second = find_array(starts, ca->num_arrays, p->second);
+        clustered[n++].pair = p;
+    }
+    qsort(clustered, n, sizeof(clustered_pair), compare_clustered);
+    ca->num_conflicts = 0;
+    conflict* c = NULL;
+    for (size_t i = 0; i < n; ++i) {
+        if (i == 0 || clustered[i].first != clustered[i - 1].first
+                || clustered[i].second != clustered[i - 1].second) {
+            c = &ca->conflicts[ca->num_conflicts++];
+            *c = (conflict) {0};
+            c->first_lo = starts[clustered[i].first] << ca->region_bits;
+            c->first_hi = (ends[clustered[i].first] + 1) << ca->region_bits;
+            c->second_lo = starts[clustered[i].second] << ca->region_bits;
+            c->second_hi = (ends[clustered[i].second] + 1)
+                           << ca->region_bits;
+            c->misses = -1;
+        }
+        c->evictions += clustered[i].pair->evictions;
+        c->distance = gcd(c->distance, clustered[i].pair->distance);
+        c->sets |= clustered[i].pair->sets;
+    }
+    qsort(ca->conflicts, ca->num_conflicts, sizeof(conflict),
+          compare_conflicts);
+
+    free(regions);
+    free(starts);
+    free(ends);
+    free(clustered);
+    return true;
+}
+
+/* Move address as the fix of c would: shift or pad its second array. */
+static uint64_t move_address(conflict* c, uint64_t address)
+{
+    if (address < c->second_lo || address >= c->second_hi)
+        return address;
+    if (c->stride == 0)
+        return address + c->pad;
+    return address + (address - c->second_lo) / c->stride * c->pad;
+}
+
+/*
+ * Simulate the records of the trace in filename the run simulated on a
+ * cold, plain cache shaped like shape, with the addresses moved by fix if
+ * given. Returns the misses, or -1 (after reporting why) if that failed.
+ */
+static long resimulate(conflict_analyzer* ca, cache_simulator* shape,
+                       const char* filename, conflict* fix)
+{
+    FILE* file = open_trace(filename);
+    if (! file) {
+        printf("ERROR: Failed to open reference file: %s\n", filename);
+        return -1;
+    }
+    cache_simulator* cache = build_indexed_simulator(shape->offset_len,
+            shape->num_sets, shape->lines_per_set, shape->index_fn);
+    if (! cache) {
+        printf("Unable to allocate memory for "
+               "cache simulator -- aborting.\n\n");
+        close_trace(file);
+        return -1;
+    }
+    if (! set_replacement_policy(cache, shape->policy)) {
+        printf("Unable to allocate memory for "
+               "set dueling -- aborting.\n\n");
+        destroy_simulator(cache);
+        close_trace(file);
+        return -1;
+    }
+
+    instruction inst;
+    address_info addr;
+    bool more = true;
+    for (long i = 0; i < ca->first_record && more; ++i)
+        more = read_instruction(file, &inst);
+    long records = 0;
+    for (int inst_no = 0; more && (ca->max_records < 0
+                                   || records < ca->max_records)
+                          && read_instruction(file, &inst); inst_no++) {
+        records += 1 + inst.repeat;
+        uint64_t address = fix ? move_address(fix, inst.address)
+                               : inst.address;
+        get_address_info(address, &addr, cache);
+        check_cache(cache, &addr, inst_no);
+        /* the rest of a modify and any folded accesses only hit */
+        inst_no += (inst.op == 'M' ? 2 : 1) * (1 + inst.repeat) - 1;
+    }
+    long misses = cache->miss_count;
+    destroy_simulator(cache);
+    close_trace(file);
+    return misses;
+}
+
+/*
+ * Try padding the second array of c by a growing number of blocks, every
+ * distance bytes if the conflict is within one array, and keep the fix
+ * with the fewest misses. Returns false if the trace could not be read.
+ */
+static bool find_fix(conflict_analyzer* ca, conflict* c,
+                     cache_simulator* cache, const char* filename)
+{
+    uint64_t block = 1ULL << cache->offset_len;
+    conflict trial = *c;
+    trial.stride = c->first_lo == c->second_lo ? c->distance : 0;
+    if (c->first_lo == c->second_lo && c->distance < block)
+        return true;
+    for (int k = 1, tried = 0; k < cache->num_sets && tried < MAX_PADDINGS;
+         k *= 2, ++tried) {
+        trial.pad = k * block;
+        long misses = resimulate(ca, cache, filename, &trial);
+        if (misses < 0)
+            return false;
+        if (c->misses < 0 || misses < c->misses) {
+            c->misses = misses;
+            c->pad = trial.pad;
+            c->stride = trial.stride;
+        }
+    }
+    return true;
+}
+
+bool analyze_conflicts(conflict_analyzer* ca, cache_simulator* cache,
+                       const char* filename, long first_record,
+                       long max_records)
+{
+    ca->first_record = first_record;
+    ca->max_records = max_records;
+    if (! cluster_pairs(ca)) {
+        printf("Unable to allocate memory for "
+               "conflict analysis -- aborting.\n\n");
+        return false;
+    }
+    ca->baseline_misses = resimulate(ca, cache, filename, NULL);
+    if (ca->baseline_misses < 0)
+        return false;
+    for (int i = 0; i < ca->num_conflicts && i < MAX_CONFLICT_FIXES; ++i) {
+        if (! find_fix(ca, &ca->conflicts[i], cache, filename))
+            return false;
+    }
+    return true;
+}
+
+void print_conflict_report(conflict_analyzer* ca)
+{
+    printf("conflicts evictions:%ld pairs:%zu arrays:%d"
+           " baseline-misses:%ld\n", ca->evictions, ca->size,
+           ca->num_arrays, ca->baseline_misses);
+    for (int i = 0; i < ca->num_conflicts && i < MAX_CONFLICT_REPORT; ++i) {
+        conflict* c = &ca->conflicts[i];
+        printf("conflict %d %#" PRIx64 "-%#" PRIx64 " %#" PRIx64 "-%#"
+               PRIx64 " evictions:%ld sets:%d distance:%#" PRIx64,
+               i + 1, c->first_lo, c->first_hi, c->second_lo, c->second_hi,
+               c->evictions, __builtin_popcountll(c->sets), c->distance);
+        /* a fix is only suggested if it saved some misses */
+        if (c->misses >= ca->baseline_misses)
+            printf(" fix:none");
+        else if (c->misses >= 0 && c->stride != 0)
+            printf(" fix:pad-%" PRIu64 "-every-%" PRIu64, c->pad, c->stride);
+        else if (c->misses >= 0)
+            printf(" fix:shift-%" PRIu64, c->pad);
+        if (c->misses >= 0 && c->misses < ca->baseline_misses)
+            printf(" misses:%ld saved:%ld", c->misses,
+                   ca->baseline_misses - c->misses);
+        printf("\n");
+    }
+}
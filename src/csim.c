@@ -5,109 +5,196 @@
  */
 #include "../include/cachelab.h"
 #include "../include/args_reader.h"
-#include "../include/cache_simulator.h"
+#include "../include/trace_mux.h"
+#include "../include/coherence.h"
+#include "../include/regions.h"
+#include "../include/intervals.h"
+#include "../include/simulation.h"
+#include "../include/batch.h"
+#include "../include/phases.h"
 #include "../include/instruction_reader.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <inttypes.h>
 
-/* outputs the results of an operation */
-void print_result(op_state state);
-void partition_address(address_info* addr, int tag_len, int index_len,
-                       int offset_len, uint64_t address);
+/* runs the multi-core model over the traces given in args */
+int simulate_multicore(program_args* args);
+/* adds up the hits, misses and evictions of every core */
+void sum_core_counts(coherent_system* sys, int* hits, int* misses,
+                     int* evictions);
+/* runs every job in the batch manifest given in args */
+int simulate_batch(program_args* args);
+/* profiles the phases of the trace given in args and picks simpoints */
+int find_phases(program_args* args);
 
 int main(int argc, char** argv)
 {
     // get command line arguments
     program_args args;
-    args.s = args.b = args.E = 0;
-    args.verbose = false;
-    args.ref_filename = NULL;
+    init_args(&args);
     if (! get_args(&args, argc, argv)) {
         report_failure();
         return EXIT_FAILURE;
     }
+    if (args.batch_filename)
+        return simulate_batch(&args);
+    if (args.phase_interval > 0)
+        return find_phases(&args);
+    if (args.cores > 1) {
+        if (args.checkpoint_out || args.restore_filename
+                || regions_enabled(&args.regions) || args.event_log
+                || args.reduce || args.sectors > 0) {
+            printf("ERROR: checkpoints, regions, event logs, trace"
+                   " reduction and sectors are not supported with several"
+                   " cores\n");
+            return EXIT_FAILURE;
+        }
+        /* every core is a plain LRU cache of -s, -E and -b */
+        if (args.policy != REPLACE_LRU || args.num_sets > 0
+                || args.index_fn != INDEX_BIT_SLICE
+                || args.prefetch != PREFETCH_NONE || args.victim_entries > 0
+                || args.num_tlb_levels > 0 || args.timing || args.tenants
+                || args.heatmap || args.conflict_bits > 0
+                || args.simpoints_file || args.start_at > 0
+                || args.max_records >= 0) {
+            printf("ERROR: replacement policies, set counts, indexing,"
+                   " prefetchers, victim and miss caches, TLBs, timing,"
+                   " tenants, heatmaps, conflicts, simpoints and record"
+                   " ranges are not supported with several cores\n");
+            return EXIT_FAILURE;
+        }
+        return simulate_multicore(&args);
+    }
+
+    simulation* sim = build_simulation(&args);
+    if (! sim)
+        return EXIT_FAILURE;
+    if (! run_simulation(sim)) {
+        destroy_simulation(sim);
+        return EXIT_FAILURE;
+    }
+    print_simulation_summary(sim);
+    destroy_simulation(sim);
+
+    return EXIT_SUCCESS;
+}
 
-    // load valgrind reference file
-    FILE* ref_file = fopen(args.ref_filename, "r");
-    if (! ref_file) {
-        printf("ERROR: Failed to open reference file: %s\n", args.ref_filename);
+/*
+ * Runs the jobs of a batch manifest on a pool of threads and writes all
+ * of their results to one file.
+ */
+int simulate_batch(program_args* args)
+{
+    batch* b = read_batch_manifest(args->batch_filename);
+    if (! b)
+        return EXIT_FAILURE;
+    run_batch(b, args->jobs);
+    if (! write_batch_results(b, args->batch_out)) {
+        printf("ERROR: Failed to write batch results: %s\n",
+               args->batch_out);
+        destroy_batch(b);
         return EXIT_FAILURE;
     }
+    destroy_batch(b);
+    return EXIT_SUCCESS;
+}
 
-    // build cache
-    cache_simulator* cache = build_simulator(args.b, args.s, args.E);
-    if (! cache) {
+/*
+ * Splits the trace into intervals, clusters them by the blocks they touch
+ * and prints (and saves, if asked to) a simpoint for each cluster.
+ */
+int find_phases(program_args* args)
+{
+    FILE* trace = open_trace(args->ref_filename);
+    if (! trace) {
+        printf("ERROR: Failed to open reference file: %s\n",
+               args->ref_filename);
+        return EXIT_FAILURE;
+    }
+    phase_profile* pp = profile_phases(trace, args->b, args->phase_interval,
+                                       args->phase_clusters);
+    close_trace(trace);
+    if (! pp)
+        return EXIT_FAILURE;
+    print_phase_summary(pp);
+    if (args->simpoints_out && ! write_simpoints(pp, args->simpoints_out)) {
+        printf("ERROR: Failed to write simpoints: %s\n", args->simpoints_out);
+        destroy_phase_profile(pp);
+        return EXIT_FAILURE;
+    }
+    destroy_phase_profile(pp);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Interleaves the traces (or splits a single trace by its stream field)
+ * across coherent cores and prints the per core results.
+ */
+int simulate_multicore(program_args* args)
+{
+    trace_mux* mux = open_trace_mux(args->trace_files, args->num_traces,
+                                    args->quantum);
+    if (! mux)
+        return EXIT_FAILURE;
+    set_mux_schedule(mux, args->schedule, args->num_schedule);
+    coherent_system* sys = build_coherent_system(args->cores, args->b,
+            args->s, args->E, args->shared_s, args->shared_E, args->protocol);
+    if (! sys) {
         printf("Unable to allocate memory for "
                "cache simulator -- aborting.\n\n");
+        close_trace_mux(mux);
         return EXIT_FAILURE;
     }
 
-    // read through the instructions and process them
-    op_state result1, result2;
+    op_state result;
     instruction instr;
-    address_info addr;
-    
-    for (int inst_no = 0; read_instruction(ref_file, &instr); inst_no++) {
-        /* Fill address_info */
-        partition_address(&addr, cache->tag_len, args.s, args.b, instr.address);
-        
-        /* If the op is a modify, we know that the second cache check with be a hit. */
-        if (instr.op == 'M') {
-            result2 = CACHE_HIT;
-            inst_no += 1;
-            cache->hit_count += 1;
-        }
-        
-        /* test the cache */
-        result1 = check_cache(cache, &addr, inst_no);
-        
-        /* Print results */
-        if (args.verbose) {
-            printf("%c ", instr.op);
-            printf("%" PRIx64 , instr.address);
-            printf(",%x", instr.size);
-            print_result(result1);
-            if (instr.op == 'M')
-                print_result(result2);
-            printf("\n");
+    int hits = 0, misses = 0, evictions = 0;
+    long records = 0;
+    interval_stats intervals;
+    init_intervals(&intervals, args->interval, 0, 0, 0, 0);
+    if (args->verbose)
+        start_text_log();
+
+    for (int inst_no = 0; mux_read_instruction(mux, &instr); inst_no++) {
+        int core = instr.stream % args->cores;
+        result = coherent_access(sys, core, instr.address, instr.op != 'L',
+                                 inst_no);
+
+        /* the write half of a modify always hits, as do folded accesses */
+        int extra_hits = (instr.op == 'M' ? 2 : 1) * (1 + instr.repeat) - 1;
+        inst_no += extra_hits;
+        sys->cores[core]->hit_count += extra_hits;
+
+        if (args->verbose)
+            log_text_access(core, instr.op, instr.address, instr.size,
+                            result);
+
+        records += 1 + instr.repeat;
+        if (args->interval > 0
+                && records - intervals.first >= args->interval) {
+            sum_core_counts(sys, &hits, &misses, &evictions);
+            interval_record(&intervals, records, hits, misses, evictions);
         }
     }
-    fclose(ref_file);
-    // print the results
-    printSummary(cache->hit_count, cache->miss_count, cache->eviction_count);
-    destroy_simulator(cache);
+    close_trace_mux(mux);
 
+    sum_core_counts(sys, &hits, &misses, &evictions);
+    interval_finish(&intervals, records, hits, misses, evictions);
+    printSummary(hits, misses, evictions);
+    print_coherence_summary(sys);
+    destroy_coherent_system(sys);
     return EXIT_SUCCESS;
 }
 
-/* Extract the address tag, offset index, and offset. */
-void partition_address(address_info* addr, int tag_len, int index_len,
-                       int offset_len, uint64_t address)
-{
-    int tag_mask = ~(-1 << (tag_len));
-    int offset_mask = ~(-1 << index_len);
-    /* Get the tag bits from address */
-    addr->tag = (address >> (offset_len + index_len)) & tag_mask;
-    /* Get the set index bits from address */
-    addr->set_index = (address >> offset_len) & offset_mask;
-    /* Get the byte offset bits from address */
-    addr->offset = address & offset_mask;
-}
-
-/* Prints whether a cache op resulted in a hit, miss or eviction. */
-void print_result(op_state state)
+/* Totals the hits, misses and evictions of every core. */
+void sum_core_counts(coherent_system* sys, int* hits, int* misses,
+                     int* evictions)
 {
-    switch (state) {
-        case CACHE_HIT:
-            printf(" hit");
-            break;
-        case CACHE_MISS:
-            printf(" miss");
-            break;
-        case CACHE_EVICTION:
-            printf(" miss eviction");
-            break;
+    *hits = *misses = *evictions = 0;
+    for (int i = 0; i < sys->num_cores; ++i) {
+        *hits += sys->cores[i]->hit_count;
+        *misses += sys->cores[i]->miss_count;
+        *evictions += sys->cores[i]->eviction_count;
     }
 }
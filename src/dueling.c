@@ -0,0 +1,110 @@
+/*
+ * dueling.c
+ * Leader sets and the policy selector of adaptive insertion.
+ */
+#include "../include/dueling.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* The selector's largest value; above half of it the second policy wins. */
+#define PSEL_MAX ((1 << PSEL_BITS) - 1)
+
+dueling* build_dueling(int num_sets, const char* first, const char* second)
+{
+    dueling* d = calloc(1, sizeof(dueling));
+    if (d == NULL)
+        return NULL;
+    d->names[0] = first;
+    d->names[1] = second;
+    /* leave some followers, even with a single pair of leaders */
+    d->leaders = num_sets / 4 < DUELING_LEADERS ? num_sets / 4
+                                                : DUELING_LEADERS;
+    if (d->leaders == 0 && num_sets >= DUELING_MIN_SETS)
+        d->leaders = 1;
+    d->stride = d->leaders ? num_sets / d->leaders : 0;
+    d->psel = PSEL_MAX / 2;
+    return d;
+}
+
+void destroy_dueling(dueling* d)
+{
+    free(d->runs);
+    free(d);
+}
+
+/* Return the policy set leads for, or -1 for a follower. */
+static int leader_of(dueling* d, int set)
+{
+    if (d->stride == 0 || set / d->stride >= d->leaders)
+        return -1;
+    if (set % d->stride == 0)
+        return 0;
+    if (set % d->stride == d->stride / 2)
+        return 1;
+    return -1;
+}
+
+/* Return the policy the followers insert with. */
+static int winner(dueling* d)
+{
+    return d->psel > PSEL_MAX / 2;
+}
+
+int dueling_choice(dueling* d, int set)
+{
+    int leader = leader_of(d, set);
+    if (leader >= 0)
+        return leader;
+    int policy = winner(d);
+    d->follower_fills[policy] += 1;
+    return policy;
+}
+
+void dueling_access(dueling* d)
+{
+    if (++d->accesses % DUELING_EPOCH != 0)
+        return;
+    int policy = winner(d);
+    if (d->num_runs > 0 && d->runs[d->num_runs - 1].policy == policy) {
+        d->runs[d->num_runs - 1].epochs += 1;
+        return;
+    }
+    if (d->num_runs == d->runs_capacity) {
+        int capacity = d->runs_capacity ? d->runs_capacity * 2 : 16;
+        dueling_run* runs = realloc(d->runs, capacity * sizeof(dueling_run));
+        /* without memory the timeline just stops growing */
+        if (runs == NULL)
+            return;
+        d->runs = runs;
+        d->runs_capacity = capacity;
+    }
+    d->runs[d->num_runs++] = (dueling_run) {policy, 1};
+}
+
+void dueling_miss(dueling* d, int set)
+{
+    int leader = leader_of(d, set);
+    if (leader < 0)
+        return;
+    d->leader_misses[leader] += 1;
+    if (leader == 0 && d->psel < PSEL_MAX)
+        d->psel += 1;
+    else if (leader == 1 && d->psel > 0)
+        d->psel -= 1;
+}
+
+void print_dueling_summary(dueling* d)
+{
+    printf("dueling winner:%s psel:%d leaders:%d %s-leader-misses:%lu"
+           " %s-leader-misses:%lu %s-follower-fills:%lu"
+           " %s-follower-fills:%lu timeline:", d->names[winner(d)], d->psel,
+           d->leaders, d->names[0], d->leader_misses[0], d->names[1],
+           d->leader_misses[1], d->names[0], d->follower_fills[0],
+           d->names[1], d->follower_fills[1]);
+    for (int i = 0; i < d->num_runs; ++i)
+        printf("%s%ld%s", i ? "-" : "", d->runs[i].epochs,
+               d->names[d->runs[i].policy]);
+    printf("%s\n", d->num_runs ? "" : "none");
+}
@@ -0,0 +1,157 @@
+/*
+ * event_log.c
+ * Buffered text and binary access logs.
+ */
+#include "../include/event_log.h"
+#include "../include/cache_simulator.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* The longest line log_text_access writes. */
+#define TEXT_LINE_MAX 64
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/* Write value in lower case hex at out, returning the first byte past it. */
+static char* put_hex(char* out, uint64_t value)
+{
+    char digits[16];
+    int n = 0;
+    do {
+        digits[n++] = hex_digits[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+    while (n > 0)
+        *out++ = digits[--n];
+    return out;
+}
+
+/* Write a non negative value in decimal. */
+static char* put_decimal(char* out, unsigned value)
+{
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    while (n > 0)
+        *out++ = digits[--n];
+    return out;
+}
+
+/* Write the text print_result would. */
+static char* put_result(char* out, op_state result)
+{
+    static const char hit[] = " hit", miss[] = " miss",
+                      eviction[] = " miss eviction";
+    const char* text = result == CACHE_HIT ? hit
+                       : result == CACHE_MISS ? miss : eviction;
+    size_t len = strlen(text);
+    memcpy(out, text, len);
+    return out + len;
+}
+
+/* Write the buffered records to the file. */
+static bool flush_events(event_log* log)
+{
+    size_t count = log->buffered;
+    log->buffered = 0;
+    return fwrite(log->records, sizeof(event_record), count, log->file)
+           == count;
+}
+
+void start_text_log(void)
+{
+    setvbuf(stdout, NULL, _IOFBF, TEXT_LOG_BUFFER);
+}
+
+void log_text_access(int core, char op, uint64_t address, unsigned size,
+                     op_state result)
+{
+    char line[TEXT_LINE_MAX];
+    char* out = line;
+    if (core >= 0) {
+        out = put_decimal(out, core);
+        *out++ = ' ';
+    }
+    *out++ = op;
+    *out++ = ' ';
+    out = put_hex(out, address);
+    *out++ = ',';
+    out = put_hex(out, size);
+    out = put_result(out, result);
+    if (op == 'M')
+        out = put_result(out, CACHE_HIT);
+    *out++ = '\n';
+    fwrite(line, 1, out - line, stdout);
+}
+
+event_log* open_event_log(const char* path, cache_simulator* cache)
+{
+    event_log* log = malloc(sizeof(event_log));
+    if (log == NULL) {
+        printf("Unable to allocate memory for event log -- aborting.\n\n");
+        return NULL;
+    }
+    log->file = fopen(path, "wb");
+    if (! log->file) {
+        printf("ERROR: Failed to create event log: %s\n", path);
+        free(log);
+        return NULL;
+    }
+    log->buffered = 0;
+    log->num_records = 0;
+    log->failed = false;
+
+    /* the header is written again with the record count on close */
+    event_log_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic));
+    header.version = EVENT_LOG_VERSION;
+    header.record_size = sizeof(event_record);
+    header.offset_len = cache->offset_len;
+    header.num_sets = cache->num_sets;
+    header.lines_per_set = cache->lines_per_set;
+    header.index_fn = cache->index_fn;
+    if (fwrite(&header, sizeof(header), 1, log->file) != 1) {
+        printf("ERROR: Failed to create event log: %s\n", path);
+        fclose(log->file);
+        free(log);
+        return NULL;
+    }
+    return log;
+}
+
+void log_event(event_log* log, uint64_t index, char op, unsigned set,
+               op_state result, uint64_t evicted_tag)
+{
+    event_record* record = &log->records[log->buffered++];
+    record->index = index;
+    record->evicted_tag = result == CACHE_EVICTION ? evicted_tag : 0;
+    record->set = set;
+    record->outcome = result;
+    record->op = op;
+    record->reserved = 0;
+    log->num_records += 1;
+    if (log->buffered == EVENT_LOG_BUFFER && ! flush_events(log))
+        log->failed = true;
+}
+
+bool close_event_log(event_log* log)
+{
+    bool written = flush_events(log) && ! log->failed;
+    /* fill in the record count now that it is known */
+    uint64_t num_records = log->num_records;
+    written = written
+        && fseek(log->file, offsetof(event_log_header, num_records),
+                 SEEK_SET) == 0
+        && fwrite(&num_records, sizeof(num_records), 1, log->file) == 1;
+    written = fclose(log->file) == 0 && written;
+    free(log);
+    return written;
+}
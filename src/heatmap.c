@@ -0,0 +1,369 @@
+/*
+ * heatmap.c
+ * Per set and per region counters.
+ */
+#include "../include/heatmap.h"
+#include "../include/cache_simulator.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* A set or region with its name, ordered by order when written out. */
+typedef struct {
+    char id[MAX_SYMBOL_NAME];
+    uint64_t order;
+    heat_counts* counts;
+} heat_entry;
+
+/* The name of the region holding addresses outside every symbol. */
+#define OTHER_REGION "[other]"
+
+static int compare_symbols(const void* a, const void* b)
+{
+    const symbol_range* x = a;
+    const symbol_range* y = b;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+/*
+ * Read the ranges of a symbol file into hm, sorted by start. Returns false
+ * (after reporting why) if the file could not be read or is not valid.
+ */
+static bool read_symbols(heatmap* hm, const char* path)
+{
+    char buffer[256], name[MAX_SYMBOL_NAME];
+    int line_no = 0, capacity = 0;
+    FILE* file = fopen(path, "r");
+    if (! file) {
+        printf("ERROR: Failed to open symbol file: %s\n", path);
+        return false;
+    }
+    while (fgets(buffer, sizeof(buffer), file)) {
+        uint64_t start, end;
+        line_no += 1;
+        int fields = sscanf(buffer, "%63s %" SCNx64 " %" SCNx64, name,
+                            &start, &end);
+        if (fields <= 0 || name[0] == '#')
+            continue;
+        if (fields != 3 || start >= end || strpbrk(name, "\",\\")) {
+            printf("ERROR: %s:%d is not \"name start end\"\n", path,
+                   line_no);
+            fclose(file);
+            return false;
+        }
+        if (hm->num_symbols == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            symbol_range* grown = realloc(hm->symbols,
+                                          capacity * sizeof(symbol_range));
+            if (grown == NULL) {
+                printf("Unable to allocate memory for "
+                       "symbols -- aborting.\n\n");
+                fclose(file);
+                return false;
+            }
+            hm->symbols = grown;
+        }
+        symbol_range* s = &hm->symbols[hm->num_symbols++];
+        strcpy(s->name, name);
+        s->start = start;
+        s->end = end;
+    }
+    fclose(file);
+
+    qsort(hm->symbols, hm->num_symbols, sizeof(symbol_range),
+          compare_symbols);
+    for (int i = 1; i < hm->num_symbols; ++i) {
+        if (hm->symbols[i].start < hm->symbols[i - 1].end) {
+            printf("ERROR: symbols %s and %s overlap\n",
+                   hm->symbols[i - 1].name, hm->symbols[i].name);
+            return false;
+        }
+    }
+    hm->symbol_counts = calloc(hm->num_symbols + 1, sizeof(heat_counts));
+    if (hm->symbol_counts == NULL) {
+        printf("Unable to allocate memory for symbols -- aborting.\n\n");
+        return false;
+    }
+    return true;
+}
+
+heatmap* build_heatmap(int num_sets, int region_bits,
+                       const char* symbols_file)
+{
+    heatmap* hm = calloc(1, sizeof(heatmap));
+    if (hm == NULL) {
+        printf("Unable to allocate memory for heatmap -- aborting.\n\n");
+        return NULL;
+    }
+    hm->num_sets = num_sets;
+    hm->region_bits = region_bits;
+    hm->capacity = 1024;
+    hm->sets = calloc(num_sets, sizeof(heat_counts));
+    hm->region_keys = calloc(hm->capacity, sizeof(uint64_t));
+    hm->regions = calloc(hm->capacity, sizeof(heat_counts));
+    if (! hm->sets || ! hm->region_keys || ! hm->regions) {
+        printf("Unable to allocate memory for heatmap -- aborting.\n\n");
+        destroy_heatmap(hm);
+        return NULL;
+    }
+    if (symbols_file && ! read_symbols(hm, symbols_file)) {
+        destroy_heatmap(hm);
+        return NULL;
+    }
+    return hm;
+}
+
+void destroy_heatmap(heatmap* hm)
+{
+    free(hm->sets);
+    free(hm->region_keys);
+    free(hm->regions);
+    free(hm->symbols);
+    free(hm->symbol_counts);
+    free(hm);
+}
+
+/* Return the slot of key, or the empty slot it belongs in. */
+static size_t region_slot(uint64_t* keys, size_t capacity, uint64_t key)
+{
+    size_t slot = (key * 0x9E3779B97F4A7C15ULL) & (capacity - 1);
+    while (keys[slot] != 0 && keys[slot] != key)
+        slot = (slot + 1) & (capacity - 1);
+    return slot;
+}
+
+/*
+ * Grow the map of regions to twice its size. Returns false if memory ran
+ * out.
+ */
+static bool grow_regions(heatmap* hm)
+{
+    size_t capacity = hm->capacity * 2;
+    uint64_t* keys = calloc(capacity, sizeof(uint64_t));
+    heat_counts* regions = calloc(capacity, sizeof(heat_counts));
+    if (keys == NULL || regions == NULL) {
+        free(keys);
+        free(regions);
+        return false;
+    }
+    for (size_t i = 0; i < hm->capacity; ++i) {
+        if (hm->region_keys[i] == 0)
+            continue;
+        size_t slot = region_slot(keys, capacity, hm->region_keys[i]);
+        keys[slot] = hm->region_keys[i];
+        regions[slot] = hm->regions[i];
+    }
+    free(hm->region_keys);
+    free(hm->regions);
+    hm->region_keys = keys;
+    hm->regions = regions;
+    hm->capacity = capacity;
+    return true;
+}
+
+/* Return the counts of the region of address, NULL if memory ran out. */
+static heat_counts* region_counts(heatmap* hm, uint64_t address)
+{
+    if (hm->symbols) {
+        /* find the last symbol starting at or before address */
+        int lo = 0, hi = hm->num_symbols;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (hm->symbols[mid].start <= address)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo > 0 && address < hm->symbols[lo - 1].end)
+            return &hm->symbol_counts[lo - 1];
+        return &hm->symbol_counts[hm->num_symbols];
+    }
+    uint64_t key = (address >> hm->region_bits) + 1;
+    size_t slot = region_slot(hm->region_keys, hm->capacity, key);
+    if (hm->region_keys[slot] == 0) {
+        if ((hm->size + 1) * 2 > hm->capacity) {
+            if (! grow_regions(hm))
+                return NULL;
+            slot = region_slot(hm->region_keys, hm->capacity, key);
+        }
+        hm->region_keys[slot] = key;
+        hm->size += 1;
+    }
+    return &hm->regions[slot];
+}
+
+bool heatmap_access(heatmap* hm, int set, uint64_t address, int accesses,
+                    op_state result)
+{
+    heat_counts* region = region_counts(hm, address);
+    if (region == NULL)
+        return false;
+    heat_counts* counts[2] = {&hm->sets[set], region};
+    for (int i = 0; i < 2; ++i) {
+        counts[i]->accesses += accesses;
+        counts[i]->misses += result != CACHE_HIT;
+        counts[i]->evictions += result == CACHE_EVICTION;
+    }
+    return true;
+}
+
+bool heatmap_evicted(heatmap* hm, uint64_t address)
+{
+    heat_counts* region = region_counts(hm, address);
+    if (region == NULL)
+        return false;
+    region->evicted += 1;
+    return true;
+}
+
+static int compare_order(const void* a, const void* b)
+{
+    const heat_entry* x = a;
+    const heat_entry* y = b;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+/* Rank entries by misses, most first, then by their order. */
+static int compare_misses(const void* a, const void* b)
+{
+    const heat_entry* x = a;
+    const heat_entry* y = b;
+    if (x->counts->misses != y->counts->misses)
+        return x->counts->misses < y->counts->misses ? 1 : -1;
+    return compare_order(a, b);
+}
+
+/*
+ * Return the sets with accesses in order, setting *count, or NULL if
+ * memory ran out.
+ */
+static heat_entry* collect_sets(heatmap* hm, int* count)
+{
+    heat_entry* entries = malloc((hm->num_sets + 1) * sizeof(heat_entry));
+    *count = 0;
+    for (int i = 0; entries && i < hm->num_sets; ++i) {
+        if (hm->sets[i].accesses == 0)
+            continue;
+        heat_entry* e = &entries[(*count)++];
+        snprintf(e->id, sizeof(e->id), "%d", i);
+        e->order = i;
+        e->counts = &hm->sets[i];
+    }
+    return entries;
+}
+
+/*
+ * Return the regions with accesses or evictions in address order, setting
+ * *count, or NULL if memory ran out.
+ */
+static heat_entry* collect_regions(heatmap* hm, int* count)
+{
+    size_t most = hm->symbols ? hm->num_symbols + 1 : hm->size;
+    heat_entry* entries = malloc((most + 1) * sizeof(heat_entry));
+    *count = 0;
+    if (entries == NULL)
+        return NULL;
+    if (hm->symbols) {
+        for (int i = 0; i <= hm->num_symbols; ++i) {
+            heat_counts* c = &hm->symbol_counts[i];
+            if (c->accesses == 0 && c->evicted == 0)
+                continue;
+            heat_entry* e = &entries[(*count)++];
+            strcpy(e->id, i < hm->num_symbols ? hm->symbols[i].name
+                                              : OTHER_REGION);
+            e->order = i;
+            e->counts = c;
+        }
+        return entries;
+    }
+    for (size_t i = 0; i < hm->capacity; ++i) {
+        if (hm->region_keys[i] == 0)
+            continue;
+        heat_entry* e = &entries[(*count)++];
+        e->order = (hm->region_keys[i] - 1) << hm->region_bits;
+        snprintf(e->id, sizeof(e->id), "%#" PRIx64, e->order);
+        e->counts = &hm->regions[i];
+    }
+    qsort(entries, *count, sizeof(heat_entry), compare_order);
+    return entries;
+}
+
+static void write_csv(FILE* file, const char* kind, heat_entry* entries,
+                      int count)
+{
+    for (int i = 0; i < count; ++i) {
+        heat_counts* c = entries[i].counts;
+        fprintf(file, "%s,%s,%ld,%ld,%ld,%ld\n", kind, entries[i].id,
+                c->accesses, c->misses, c->evictions, c->evicted);
+    }
+}
+
+static void write_json(FILE* file, const char* kind, heat_entry* entries,
+                       int count, bool quote)
+{
+    fprintf(file, "  \"%ss\": [\n", kind);
+    for (int i = 0; i < count; ++i) {
+        heat_counts* c = entries[i].counts;
+        fprintf(file, quote ? "    {\"%s\": \"%s\"" : "    {\"%s\": %s",
+                kind, entries[i].id);
+        fprintf(file, ", \"accesses\": %ld, \"misses\": %ld, \"evictions\":"
+                " %ld, \"evicted\": %ld}%s\n", c->accesses, c->misses,
+                c->evictions, c->evicted, i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]");
+}
+
+bool write_heatmap(heatmap* hm, const char* path)
+{
+    int num_sets, num_regions;
+    heat_entry* sets = collect_sets(hm, &num_sets);
+    heat_entry* regions = collect_regions(hm, &num_regions);
+    size_t len = strlen(path);
+    bool json = len >= 5 && strcmp(path + len - 5, ".json") == 0;
+    FILE* file = sets && regions ? fopen(path, "w") : NULL;
+    if (! file) {
+        free(sets);
+        free(regions);
+        return false;
+    }
+    if (json) {
+        fprintf(file, "{\n");
+        write_json(file, "set", sets, num_sets, false);
+        fprintf(file, ",\n");
+        write_json(file, "region", regions, num_regions, true);
+        fprintf(file, "\n}\n");
+    } else {
+        fprintf(file, "kind,id,accesses,misses,evictions,evicted\n");
+        write_csv(file, "set", sets, num_sets);
+        write_csv(file, "region", regions, num_regions);
+    }
+    free(sets);
+    free(regions);
+    return fclose(file) == 0;
+}
+
+void print_heatmap_top(heatmap* hm, int top)
+{
+    int num_sets, num_regions;
+    heat_entry* sets = collect_sets(hm, &num_sets);
+    heat_entry* regions = collect_regions(hm, &num_regions);
+    if (sets && regions) {
+        qsort(sets, num_sets, sizeof(heat_entry), compare_misses);
+        qsort(regions, num_regions, sizeof(heat_entry), compare_misses);
+        for (int i = 0; i < num_sets && i < top; ++i) {
+            heat_counts* c = sets[i].counts;
+            printf("heatmap set:%s accesses:%ld misses:%ld evictions:%ld\n",
+                   sets[i].id, c->accesses, c->misses, c->evictions);
+        }
+        for (int i = 0; i < num_regions && i < top; ++i) {
+            heat_counts* c = regions[i].counts;
+            printf("heatmap region:%s accesses:%ld misses:%ld evictions:%ld"
+                   " evicted:%ld\n", regions[i].id, c->accesses, c->misses,
+                   c->evictions, c->evicted);
+        }
+    }
+    free(sets);
+    free(regions);
+}
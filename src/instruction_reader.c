@@ -6,10 +6,24 @@
 #include "../include/instruction_reader.h"
 #include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
+
+FILE* open_trace(const char* filename)
+{
+    if (strcmp(filename, "-") == 0)
+        return stdin;
+    return fopen(filename, "r");
+}
+
+void close_trace(FILE* file)
+{
+    if (file != stdin)
+        fclose(file);
+}
 
 /* 
  * Reads a valgrind reference instruction in the format
- * [op] [address],[size]
+ * [op] [address],[size][,stream[,repeat]]
  * Returns 0 if a valid instruction was not found, otherwise
  * returns 1.
  */
@@ -22,16 +36,25 @@ int read_instruction(FILE* file, instruction* inst)
         return 0;
     }
     while (first_char != ' ') {
-        while ((first_char = fgetc(file)) != '\n')
-            ;
+        while (first_char != '\n' && first_char != EOF)
+            first_char = fgetc(file);
+        if (first_char == EOF)
+            return 0;
         first_char = fgetc(file);
     }
     
     int op = fgetc(file);
     uint64_t addr;
-    unsigned size;
+    unsigned size, stream = 0, repeat = 0;
     fscanf(file, "%" PRIx64 "", &addr);
     fscanf(file, ",%x", &size);
+    first_char = fgetc(file);
+    if (first_char == ',') {
+        fscanf(file, "%u", &stream);
+        first_char = fgetc(file);
+        if (first_char == ',')
+            fscanf(file, "%u", &repeat);
+    }
     
     /* Read to the beginning of the next instruction */
     while (first_char != '\n' && first_char != EOF) {
@@ -41,5 +64,17 @@ int read_instruction(FILE* file, instruction* inst)
     inst->op = op;
     inst->address = addr;
     inst->size = size;
+    inst->stream = stream;
+    inst->repeat = repeat;
     return 1;
+}
+
+void write_instruction(FILE* file, instruction* inst)
+{
+    fprintf(file, " %c %" PRIx64 ",%x", inst->op, inst->address, inst->size);
+    if (inst->stream != 0 || inst->repeat != 0)
+        fprintf(file, ",%u", inst->stream);
+    if (inst->repeat != 0)
+        fprintf(file, ",%u", inst->repeat);
+    fputc('\n', file);
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+/*
+ * intervals.c
+ * Periodic interval statistics.
+ */
+#include "../include/intervals.h"
+#include <stdio.h>
+
+/* Print the interval that ends just before record end and start the next. */
+static void end_interval(interval_stats* is, long end, int hits, int misses,
+                         int evictions)
+{
+    int interval_hits = hits - is->hits;
+    int interval_misses = misses - is->misses;
+    int accesses = interval_hits + interval_misses;
+    double rate = accesses ? (double) interval_misses / accesses : 0;
+    double total_rate = hits + misses ? (double) misses / (hits + misses)
+                                      : 0;
+    printf("interval records:%ld-%ld hits:%d misses:%d evictions:%d"
+           " miss-rate:%.4f total-miss-rate:%.4f\n", is->first, end - 1,
+           interval_hits, interval_misses, evictions - is->evictions, rate,
+           total_rate);
+    /* someone may be watching a pipe */
+    fflush(stdout);
+    is->first = end;
+    is->hits = hits;
+    is->misses = misses;
+    is->evictions = evictions;
+}
+
+void init_intervals(interval_stats* is, long length, long first, int hits,
+                    int misses, int evictions)
+{
+    is->length = length;
+    is->first = first;
+    is->hits = hits;
+    is->misses = misses;
+    is->evictions = evictions;
+}
+
+void interval_record(interval_stats* is, long records, int hits,
+                     int misses, int evictions)
+{
+    if (is->length > 0 && records - is->first >= is->length)
+        end_interval(is, records, hits, misses, evictions);
+}
+
+void interval_finish(interval_stats* is, long records, int hits,
+                     int misses, int evictions)
+{
+    if (is->length > 0 && records > is->first)
+        end_interval(is, records, hits, misses, evictions);
+}
@@ -0,0 +1,180 @@
+/*
+ * opt_oracle.c
+ * Next use distances for OPT replacement.
+ */
+#include "../include/opt_oracle.h"
+#include "../include/cache_simulator.h"
+#include "../include/instruction_reader.h"
+#include "../include/trace_reducer.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* The map from a block to the last access to it seen by the backward pass. */
+typedef struct {
+    /* blocks are stored plus one so that 0 marks an empty slot */
+    uint64_t* blocks;
+    int32_t* uses;
+    size_t capacity, size;
+} use_map;
+
+/* Return the slot of block, or the empty slot it belongs in. */
+static size_t map_slot(use_map* map, uint64_t block)
+{
+    uint64_t key = block + 1;
+    size_t slot = (key * 0x9E3779B97F4A7C15ULL) & (map->capacity - 1);
+    while (map->blocks[slot] != 0 && map->blocks[slot] != key)
+        slot = (slot + 1) & (map->capacity - 1);
+    return slot;
+}
+
+/* Grow the map to twice its size. Returns false if memory ran out. */
+static bool map_grow(use_map* map)
+{
+    use_map grown = {NULL, NULL, map->capacity * 2, map->size};
+    grown.blocks = calloc(grown.capacity, sizeof(uint64_t));
+    grown.uses = malloc(grown.capacity * sizeof(int32_t));
+    if (grown.blocks == NULL || grown.uses == NULL) {
+        free(grown.blocks);
+        free(grown.uses);
+        return false;
+    }
+    for (size_t i = 0; i < map->capacity; ++i) {
+        if (map->blocks[i] == 0)
+            continue;
+        size_t slot = map_slot(&grown, map->blocks[i] - 1);
+        grown.blocks[slot] = map->blocks[i];
+        grown.uses[slot] = map->uses[i];
+    }
+    free(map->blocks);
+    free(map->uses);
+    *map = grown;
+    return true;
+}
+
+/*
+ * Write the block of every access from the current position of file to
+ * blocks, returning the number of accesses or -1 on error.
+ */
+static long write_blocks(cache_simulator* cache, FILE* file, bool reduce,
+                         FILE* blocks)
+{
+    instruction inst;
+    address_info addr;
+    long accesses = 0;
+    trace_reducer* reducer = NULL;
+    if (reduce && (reducer = build_trace_reducer(file, cache->offset_len))
+                  == NULL)
+        return -1;
+    while (reducer ? reduce_instruction(reducer, &inst)
+                   : read_instruction(file, &inst)) {
+        get_address_info(inst.address, &addr, cache);
+        uint64_t block = get_block_address(cache, &addr);
+        if (fwrite(&block, sizeof(block), 1, blocks) != 1
+                || accesses == OPT_NEVER) {
+            accesses = -1;
+            break;
+        }
+        accesses += 1;
+    }
+    if (reducer)
+        destroy_trace_reducer(reducer);
+    return accesses;
+}
+
+/*
+ * Walk blocks backwards a chunk at a time, writing the next use of every
+ * access to the same place in next_uses. Returns false on error.
+ */
+static bool find_next_uses(FILE* blocks, FILE* next_uses, long accesses)
+{
+    use_map map = {NULL, NULL, 1024, 0};
+    uint64_t* chunk = malloc(OPT_CHUNK * sizeof(uint64_t));
+    int32_t* uses = malloc(OPT_CHUNK * sizeof(int32_t));
+    map.blocks = calloc(map.capacity, sizeof(uint64_t));
+    map.uses = malloc(map.capacity * sizeof(int32_t));
+    bool ok = chunk && uses && map.blocks && map.uses;
+
+    for (long start = (accesses - 1) / OPT_CHUNK * OPT_CHUNK;
+         ok && start >= 0; start -= OPT_CHUNK) {
+        long count = accesses - start < OPT_CHUNK ? accesses - start
+                                                  : OPT_CHUNK;
+        ok = fseek(blocks, start * sizeof(uint64_t), SEEK_SET) == 0
+            && fread(chunk, sizeof(uint64_t), count, blocks)
+               == (size_t) count;
+        for (long i = count - 1; ok && i >= 0; --i) {
+            size_t slot = map_slot(&map, chunk[i]);
+            if (map.blocks[slot] == 0) {
+                uses[i] = OPT_NEVER;
+                map.blocks[slot] = chunk[i] + 1;
+                map.size += 1;
+            } else {
+                uses[i] = map.uses[slot];
+            }
+            map.uses[slot] = start + i;
+            if (map.size * 2 > map.capacity)
+                ok = map_grow(&map);
+        }
+        ok = ok && fseek(next_uses, start * sizeof(int32_t), SEEK_SET) == 0
+            && fwrite(uses, sizeof(int32_t), count, next_uses)
+               == (size_t) count;
+    }
+    free(chunk);
+    free(uses);
+    free(map.blocks);
+    free(map.uses);
+    return ok;
+}
+
+opt_oracle* build_opt_oracle(cache_simulator* cache, FILE* file,
+                             bool reduce)
+{
+    opt_oracle* oo = calloc(1, sizeof(opt_oracle));
+    if (oo == NULL) {
+        printf("Unable to allocate memory for OPT oracle -- aborting.\n\n");
+        return NULL;
+    }
+    long start = ftell(file);
+    FILE* blocks = tmpfile();
+    oo->next_uses = tmpfile();
+    bool ok = start >= 0 && blocks && oo->next_uses;
+    if (ok) {
+        oo->accesses = write_blocks(cache, file, reduce, blocks);
+        ok = oo->accesses >= 0
+            && find_next_uses(blocks, oo->next_uses, oo->accesses)
+            && fseek(file, start, SEEK_SET) == 0;
+    }
+    if (blocks)
+        fclose(blocks);
+    if (! ok) {
+        printf("ERROR: Failed to work out the next uses for OPT\n");
+        destroy_opt_oracle(oo);
+        return NULL;
+    }
+    rewind(oo->next_uses);
+    return oo;
+}
+
+void destroy_opt_oracle(opt_oracle* oo)
+{
+    if (oo->next_uses)
+        fclose(oo->next_uses);
+    free(oo);
+}
+
+int32_t opt_next_use(opt_oracle* oo)
+{
+    if (oo->next == oo->buffered) {
+        oo->buffered = fread(oo->buffer, sizeof(int32_t), OPT_CHUNK,
+                             oo->next_uses);
+        oo->next = 0;
+        /* past the end of what the oracle read nothing is used again */
+        if (oo->buffered <= 0) {
+            oo->buffered = 0;
+            return OPT_NEVER;
+        }
+    }
+    oo->served += 1;
+    return oo->buffer[oo->next++];
+}
@@ -0,0 +1,338 @@
+/*
+ * phases.c
+ * Interval signatures, k-means clustering and simpoint estimates.
+ */
+#include "../include/phases.h"
+#include "../include/instruction_reader.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+
+/* The bits of the block hash picking a bucket, log2 of PHASE_DIMENSIONS. */
+#define PHASE_BUCKET_BITS 6
+
+/* The most rounds of k-means before settling for the clusters found. */
+#define MAX_KMEANS_ROUNDS 100
+
+/* The signatures of the intervals profiled so far. */
+typedef struct {
+    double* vectors;
+    long* records;
+    long count, capacity;
+} signatures;
+
+/*
+ * Add the signature of an interval of records, normalising its counts.
+ * Returns false if memory ran out.
+ */
+static bool add_signature(signatures* sigs, double* counts, long records)
+{
+    if (sigs->count == sigs->capacity) {
+        long capacity = sigs->capacity ? sigs->capacity * 2 : 64;
+        double* vectors = realloc(sigs->vectors, capacity
+                                  * PHASE_DIMENSIONS * sizeof(double));
+        if (vectors == NULL)
+            return false;
+        sigs->vectors = vectors;
+        long* lengths = realloc(sigs->records, capacity * sizeof(long));
+        if (lengths == NULL)
+            return false;
+        sigs->records = lengths;
+        sigs->capacity = capacity;
+    }
+    double total = 0;
+    for (int i = 0; i < PHASE_DIMENSIONS; ++i)
+        total += counts[i];
+    double* v = &sigs->vectors[sigs->count * PHASE_DIMENSIONS];
+    for (int i = 0; i < PHASE_DIMENSIONS; ++i)
+        v[i] = total > 0 ? counts[i] / total : 0;
+    sigs->records[sigs->count++] = records;
+    return true;
+}
+
+static double distance(double* a, double* b)
+{
+    double sum = 0;
+    for (int i = 0; i < PHASE_DIMENSIONS; ++i)
+        sum += (a[i] - b[i]) * (a[i] - b[i]);
+    return sum;
+}
+
+/* Return the centroid nearest v. */
+static int nearest(double* centroids, int k, double* v)
+{
+    int best = 0;
+    double best_distance = distance(centroids, v);
+    for (int c = 1; c < k; ++c) {
+        double d = distance(&centroids[c * PHASE_DIMENSIONS], v);
+        if (d < best_distance) {
+            best = c;
+            best_distance = d;
+        }
+    }
+    return best;
+}
+
+/*
+ * Cluster the signatures with k-means, seeded with the first interval and
+ * then the interval farthest from every seed so far, so runs repeat.
+ * Returns the clusters found, at most k, or -1 if memory ran out.
+ */
+static int cluster(signatures* sigs, int k, double* centroids, int* assign)
+{
+    double* nearest_seed = malloc(sigs->count * sizeof(double));
+    long* sizes = malloc(k * sizeof(long));
+    if (nearest_seed == NULL || sizes == NULL) {
+        free(nearest_seed);
+        free(sizes);
+        return -1;
+    }
+
+    int found = 1;
+    memcpy(centroids, sigs->vectors, PHASE_DIMENSIONS * sizeof(double));
+    for (long i = 0; i < sigs->count; ++i)
+        nearest_seed[i] = distance(centroids,
+                                   &sigs->vectors[i * PHASE_DIMENSIONS]);
+    for (; found < k; ++found) {
+        long farthest = 0;
+        for (long i = 1; i < sigs->count; ++i) {
+            if (nearest_seed[i] > nearest_seed[farthest])
+                farthest = i;
+        }
+        /* every interval already sits on a seed */
+        if (nearest_seed[farthest] == 0)
+            break;
+        double* seed = &centroids[found * PHASE_DIMENSIONS];
+        memcpy(seed, &sigs->vectors[farthest * PHASE_DIMENSIONS],
+               PHASE_DIMENSIONS * sizeof(double));
+        for (long i = 0; i < sigs->count; ++i) {
+            double d = distance(seed, &sigs->vectors[i * PHASE_DIMENSIONS]);
+            if (d < nearest_seed[i])
+                nearest_seed[i] = d;
+        }
+    }
+
+    for (long i = 0; i < sigs->count; ++i)
+        assign[i] = -1;
+    for (int round = 0; round < MAX_KMEANS_ROUNDS; ++round) {
+        bool changed = false;
+        for (long i = 0; i < sigs->count; ++i) {
+            int c = nearest(centroids, found,
+                            &sigs->vectors[i * PHASE_DIMENSIONS]);
+            changed |= c != assign[i];
+            assign[i] = c;
+        }
+        if (! changed)
+            break;
+        /* move each centroid to the mean of its intervals */
+        memset(sizes, 0, found * sizeof(long));
+        for (long i = 0; i < sigs->count; ++i)
+            sizes[assign[i]] += 1;
+        for (int c = 0; c < found; ++c) {
+            if (sizes[c] > 0)
+                memset(&centroids[c * PHASE_DIMENSIONS], 0,
+                       PHASE_DIMENSIONS * sizeof(double));
+        }
+        for (long i = 0; i < sigs->count; ++i) {
+            double* centroid = &centroids[assign[i] * PHASE_DIMENSIONS];
+            double* v = &sigs->vectors[i * PHASE_DIMENSIONS];
+            for (int d = 0; d < PHASE_DIMENSIONS; ++d)
+                centroid[d] += v[d] / sizes[assign[i]];
+        }
+    }
+    free(nearest_seed);
+    free(sizes);
+    return found;
+}
+
+static int compare_points(const void* a, const void* b)
+{
+    const simpoint* x = a;
+    const simpoint* y = b;
+    return x->first < y->first ? -1 : x->first > y->first;
+}
+
+/*
+ * Make the interval nearest the centre of each cluster its simpoint.
+ * Returns false if memory ran out.
+ */
+static bool pick_simpoints(phase_profile* pp, signatures* sigs, int k)
+{
+    double centroids[MAX_PHASE_CLUSTERS * PHASE_DIMENSIONS];
+    double best_distance[MAX_PHASE_CLUSTERS];
+    long best[MAX_PHASE_CLUSTERS], records[MAX_PHASE_CLUSTERS];
+    int* assign = malloc((sigs->count + 1) * sizeof(int));
+    if (assign == NULL || (k = cluster(sigs, k, centroids, assign)) < 0) {
+        free(assign);
+        return false;
+    }
+    for (int c = 0; c < k; ++c) {
+        best[c] = -1;
+        records[c] = 0;
+    }
+    for (long i = 0; i < sigs->count; ++i) {
+        int c = assign[i];
+        double d = distance(&centroids[c * PHASE_DIMENSIONS],
+                            &sigs->vectors[i * PHASE_DIMENSIONS]);
+        records[c] += sigs->records[i];
+        if (best[c] < 0 || d < best_distance[c]) {
+            best[c] = i;
+            best_distance[c] = d;
+        }
+    }
+    for (int c = 0; c < k; ++c) {
+        if (best[c] < 0)
+            continue;
+        simpoint* sp = &pp->points[pp->num_points++];
+        memset(sp, 0, sizeof(simpoint));
+        sp->interval = best[c];
+        sp->first = best[c] * pp->interval_length;
+        sp->records = sigs->records[best[c]];
+        sp->weight = (double) records[c] / pp->total_records;
+    }
+    qsort(pp->points, pp->num_points, sizeof(simpoint), compare_points);
+    free(assign);
+    return true;
+}
+
+phase_profile* profile_phases(FILE* file, int block_bits,
+                              long interval_length, int clusters)
+{
+    phase_profile* pp = calloc(1, sizeof(phase_profile));
+    signatures sigs = {NULL, NULL, 0, 0};
+    double counts[PHASE_DIMENSIONS] = {0};
+    instruction inst;
+    long in_interval = 0;
+    bool ok = pp != NULL;
+    if (ok)
+        pp->interval_length = interval_length;
+
+    while (ok && read_instruction(file, &inst)) {
+        uint64_t block = inst.address >> block_bits;
+        counts[(block * 0x9E3779B97F4A7C15ULL)
+               >> (64 - PHASE_BUCKET_BITS)] += 1 + inst.repeat;
+        pp->total_records += 1;
+        if (++in_interval == interval_length) {
+            ok = add_signature(&sigs, counts, in_interval);
+            memset(counts, 0, sizeof(counts));
+            in_interval = 0;
+        }
+    }
+    if (ok && in_interval > 0)
+        ok = add_signature(&sigs, counts, in_interval);
+    if (ok) {
+        pp->num_intervals = sigs.count;
+        ok = sigs.count == 0 || pick_simpoints(pp, &sigs, clusters);
+    }
+    free(sigs.vectors);
+    free(sigs.records);
+    if (! ok) {
+        printf("Unable to allocate memory for "
+               "phase profile -- aborting.\n\n");
+        free(pp);
+        return NULL;
+    }
+    return pp;
+}
+
+phase_profile* read_simpoints(const char* path)
+{
+    char buffer[256];
+    FILE* file = fopen(path, "r");
+    if (! file) {
+        printf("ERROR: Failed to open simpoints: %s\n", path);
+        return NULL;
+    }
+    phase_profile* pp = calloc(1, sizeof(phase_profile));
+    if (pp == NULL) {
+        printf("Unable to allocate memory for "
+               "simpoints -- aborting.\n\n");
+        fclose(file);
+        return NULL;
+    }
+    bool ok = fgets(buffer, sizeof(buffer), file)
+        && sscanf(buffer, "simpoints %ld %ld", &pp->interval_length,
+                  &pp->total_records) == 2;
+    while (ok && fgets(buffer, sizeof(buffer), file)) {
+        simpoint* sp = &pp->points[pp->num_points];
+        ok = pp->num_points < MAX_PHASE_CLUSTERS
+            && sscanf(buffer, "simpoint %ld %ld %ld %lf", &sp->interval,
+                      &sp->first, &sp->records, &sp->weight) == 4
+            && sp->first >= 0 && sp->records > 0 && sp->weight > 0
+            && (pp->num_points == 0 || sp->first >= sp[-1].first
+                                       + sp[-1].records);
+        pp->num_points += 1;
+    }
+    fclose(file);
+    if (! ok || pp->num_points == 0) {
+        printf("ERROR: %s is not a list of simpoints\n", path);
+        free(pp);
+        return NULL;
+    }
+    return pp;
+}
+
+bool write_simpoints(phase_profile* pp, const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (! file)
+        return false;
+    fprintf(file, "simpoints %ld %ld\n", pp->interval_length,
+            pp->total_records);
+    for (int i = 0; i < pp->num_points; ++i) {
+        simpoint* sp = &pp->points[i];
+        fprintf(file, "simpoint %ld %ld %ld %.6f\n", sp->interval, sp->first,
+                sp->records, sp->weight);
+    }
+    return fclose(file) == 0;
+}
+
+void destroy_phase_profile(phase_profile* pp)
+{
+    free(pp);
+}
+
+void print_phase_summary(phase_profile* pp)
+{
+    printf("phases intervals:%ld records:%ld clusters:%d\n",
+           pp->num_intervals, pp->total_records, pp->num_points);
+    for (int i = 0; i < pp->num_points; ++i) {
+        simpoint* sp = &pp->points[i];
+        printf("simpoint interval:%ld first:%ld records:%ld weight:%.4f\n",
+               sp->interval, sp->first, sp->records, sp->weight);
+    }
+}
+
+void estimate_phase_totals(phase_profile* pp, int* hits, int* misses,
+                           int* evictions)
+{
+    double h = 0, m = 0, e = 0, weights = 0;
+    for (int i = 0; i < pp->num_points; ++i) {
+        simpoint* sp = &pp->points[i];
+        if (! sp->simulated)
+            continue;
+        h += sp->weight * sp->hits / sp->records;
+        m += sp->weight * sp->misses / sp->records;
+        e += sp->weight * sp->evictions / sp->records;
+        weights += sp->weight;
+    }
+    /* points past the end of the trace give their weight to the rest */
+    double scale = weights > 0 ? pp->total_records / weights : 0;
+    *hits = lround(h * scale);
+    *misses = lround(m * scale);
+    *evictions = lround(e * scale);
+}
+
+void print_simpoint_summary(phase_profile* pp)
+{
+    int simulated = 0;
+    for (int i = 0; i < pp->num_points; ++i)
+        simulated += pp->points[i].simulated;
+    printf("simpoints points:%d simulated-records:%ld total-records:%ld"
+           " fraction:%.4f\n", simulated, pp->simulated_records,
+           pp->total_records, pp->total_records
+           ? (double) pp->simulated_records / pp->total_records : 0);
+}
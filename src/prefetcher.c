@@ -0,0 +1,237 @@
+/*
+ * prefetcher.c
+ * Next-line, stride and stream prefetcher models.
+ */
+#include "../include/prefetcher.h"
+#include "../include/cache_simulator.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* The size of the regions the stride prefetcher watches, in bits. */
+#define STRIDE_REGION_BITS 12
+/* How far (in blocks) the second access of a stream may be from the first. */
+#define STREAM_WINDOW 2
+/* Marks a pending prefetch that was superseded by a demand miss. */
+#define CANCELLED_FILL UINT64_MAX
+
+/* Request block unless it is cached or already in flight. */
+static void issue(prefetcher* pf, cache_simulator* cache, uint64_t block);
+static void observe_stride(prefetcher* pf, cache_simulator* cache,
+                           uint64_t block);
+static void observe_stream(prefetcher* pf, cache_simulator* cache,
+                           uint64_t block, bool tagged);
+
+/* The slot in the pollution filter for a block. */
+static int filter_slot(uint64_t block)
+{
+    return (block ^ (block >> 12)) % POLLUTION_FILTER;
+}
+
+prefetcher* build_prefetcher(prefetch_kind kind, int degree, int latency)
+{
+    prefetcher* pf = calloc(1, sizeof(prefetcher));
+    if (pf == NULL)
+        return NULL;
+    pf->kind = kind;
+    pf->degree = degree;
+    pf->latency = latency;
+    return pf;
+}
+
+void destroy_prefetcher(prefetcher* pf)
+{
+    free(pf);
+}
+
+prefetch_kind parse_prefetch_kind(const char* name)
+{
+    if (strcmp(name, "next-line") == 0)
+        return PREFETCH_NEXT_LINE;
+    if (strcmp(name, "stride") == 0)
+        return PREFETCH_STRIDE;
+    if (strcmp(name, "stream") == 0)
+        return PREFETCH_STREAM;
+    return PREFETCH_NONE;
+}
+
+void prefetch_drain(prefetcher* pf, cache_simulator* cache, int inst_no)
+{
+    pf->now += 1;
+    while (pf->pending_count > 0
+            && pf->pending[pf->pending_head].ready_at < pf->now) {
+        uint64_t block = pf->pending[pf->pending_head].block;
+        uint64_t victim;
+        pf->pending_head = (pf->pending_head + 1) % PREFETCH_QUEUE;
+        pf->pending_count -= 1;
+        if (block == CANCELLED_FILL)
+            continue;
+        victim = CANCELLED_FILL;
+        prefetch_fill(cache, block, inst_no, &victim);
+        if (victim != CANCELLED_FILL)
+            pf->evicted[filter_slot(victim)] = victim + 1;
+    }
+}
+
+void prefetch_demand_miss(prefetcher* pf, uint64_t block)
+{
+    int slot = filter_slot(block);
+    if (pf->evicted[slot] == block + 1) {
+        pf->polluting += 1;
+        pf->evicted[slot] = 0;
+    }
+    for (int i = 0; i < pf->pending_count; ++i) {
+        pending_fill* fill =
+            &pf->pending[(pf->pending_head + i) % PREFETCH_QUEUE];
+        if (fill->block == block) {
+            /* the demand fetch replaces the prefetch */
+            pf->late += 1;
+            fill->block = CANCELLED_FILL;
+            break;
+        }
+    }
+}
+
+void prefetch_observe(prefetcher* pf, cache_simulator* cache, uint64_t block,
+                      bool tagged)
+{
+    switch (pf->kind) {
+        case PREFETCH_NEXT_LINE:
+            if (tagged) {
+                for (int i = 1; i <= pf->degree; ++i)
+                    issue(pf, cache, block + i);
+            }
+            break;
+        case PREFETCH_STRIDE:
+            observe_stride(pf, cache, block);
+            break;
+        case PREFETCH_STREAM:
+            observe_stream(pf, cache, block, tagged);
+            break;
+        case PREFETCH_NONE:
+            break;
+    }
+}
+
+void print_prefetch_summary(prefetcher* pf)
+{
+    printf("prefetch issued:%lu useful:%lu late:%lu polluting:%lu\n",
+           pf->issued, pf->useful, pf->late, pf->polluting);
+}
+
+static void observe_stride(prefetcher* pf, cache_simulator* cache,
+                           uint64_t block)
+{
+    int shift = STRIDE_REGION_BITS - cache->offset_len;
+    uint64_t region = shift > 0 ? block >> shift : block;
+    stride_entry* entry = NULL;
+    stride_entry* oldest = &pf->strides[0];
+
+    for (int i = 0; i < STRIDE_ENTRIES; ++i) {
+        stride_entry* curr = &pf->strides[i];
+        if (curr->valid && curr->region == region) {
+            entry = curr;
+            break;
+        }
+        if (! curr->valid
+                || (oldest->valid && curr->last_use < oldest->last_use))
+            oldest = curr;
+    }
+
+    if (entry == NULL) {
+        /* start watching this region */
+        oldest->valid = true;
+        oldest->region = region;
+        oldest->last_block = block;
+        oldest->stride = 0;
+        oldest->confidence = 0;
+        oldest->last_use = pf->now;
+        return;
+    }
+
+    entry->last_use = pf->now;
+    int64_t delta = (int64_t) (block - entry->last_block);
+    if (delta == 0)
+        return;
+    if (delta == entry->stride) {
+        if (entry->confidence < 3)
+            entry->confidence += 1;
+    } else {
+        entry->stride = delta;
+        entry->confidence = 0;
+    }
+    entry->last_block = block;
+    if (entry->confidence > 0) {
+        for (int i = 1; i <= pf->degree; ++i)
+            issue(pf, cache, block + entry->stride * i);
+    }
+}
+
+static void observe_stream(prefetcher* pf, cache_simulator* cache,
+                           uint64_t block, bool tagged)
+{
+    stream_entry* oldest = &pf->streams[0];
+
+    for (int i = 0; i < STREAM_ENTRIES; ++i) {
+        stream_entry* curr = &pf->streams[i];
+        if (! curr->valid) {
+            oldest = curr;
+            continue;
+        }
+        if (oldest->valid && curr->last_use < oldest->last_use)
+            oldest = curr;
+
+        int64_t delta = (int64_t) (block - curr->last_block);
+        if (curr->direction == 0) {
+            /* a second nearby access confirms the stream's direction */
+            if (delta == 0 || delta > STREAM_WINDOW || delta < -STREAM_WINDOW)
+                continue;
+            curr->direction = delta > 0 ? 1 : -1;
+            curr->next_prefetch = block;
+        } else {
+            /* the stream only follows accesses just ahead of it */
+            int64_t ahead = delta * curr->direction;
+            if (ahead < 0 || ahead > pf->degree + STREAM_WINDOW)
+                continue;
+            if (ahead == 0) {
+                curr->last_use = pf->now;
+                return;
+            }
+        }
+        curr->last_block = block;
+        curr->last_use = pf->now;
+        while ((int64_t) (curr->next_prefetch - block) * curr->direction
+                < pf->degree) {
+            curr->next_prefetch += curr->direction;
+            issue(pf, cache, curr->next_prefetch);
+        }
+        return;
+    }
+
+    if (tagged) {
+        /* allocate a new stream for this miss */
+        oldest->valid = true;
+        oldest->last_block = block;
+        oldest->direction = 0;
+        oldest->next_prefetch = block;
+        oldest->last_use = pf->now;
+    }
+}
+
+static void issue(prefetcher* pf, cache_simulator* cache, uint64_t block)
+{
+    if (pf->pending_count == PREFETCH_QUEUE || contains_block(cache, block))
+        return;
+    for (int i = 0; i < pf->pending_count; ++i) {
+        if (pf->pending[(pf->pending_head + i) % PREFETCH_QUEUE].block == block)
+            return;
+    }
+    pending_fill* fill =
+        &pf->pending[(pf->pending_head + pf->pending_count) % PREFETCH_QUEUE];
+    fill->block = block;
+    fill->ready_at = pf->now + pf->latency;
+    pf->pending_count += 1;
+    pf->issued += 1;
+}
@@ -0,0 +1,153 @@
+/*
+ * regions.c
+ * Warmup windows and regions of interest.
+ */
+#include "../include/regions.h"
+#include "../include/cache_simulator.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* Returns true if the record with the given index should be counted. */
+static bool inside(region_tracker* rt, long index)
+{
+    region_config* config = &rt->config;
+    bool selected;
+    if (index < config->warmup)
+        return false;
+    if (! config->use_markers && config->num_ranges == 0)
+        return true;
+    selected = rt->in_markers;
+    for (int i = 0; i < config->num_ranges && ! selected; ++i)
+        selected = index >= config->ranges[i][0]
+                   && index <= config->ranges[i][1];
+    return selected;
+}
+
+/* Start counting at record first. */
+static void open_region(region_tracker* rt, cache_simulator* cache,
+                        long first)
+{
+    rt->counting = true;
+    rt->first = first;
+    rt->base_hits = cache->hit_count;
+    rt->base_misses = cache->miss_count;
+    rt->base_evictions = cache->eviction_count;
+}
+
+/* Stop counting and record the region that ended with record last. */
+static void close_region(region_tracker* rt, cache_simulator* cache,
+                         long last)
+{
+    region_stats* region;
+    rt->counting = false;
+    if (rt->num_regions == rt->capacity) {
+        int capacity = rt->capacity ? rt->capacity * 2 : 16;
+        region_stats* grown = realloc(rt->regions,
+                                      capacity * sizeof(region_stats));
+        if (grown == NULL)
+            return;
+        rt->regions = grown;
+        rt->capacity = capacity;
+    }
+    region = &rt->regions[rt->num_regions++];
+    region->first = rt->first;
+    region->last = last;
+    region->hits = cache->hit_count - rt->base_hits;
+    region->misses = cache->miss_count - rt->base_misses;
+    region->evictions = cache->eviction_count - rt->base_evictions;
+    rt->hits += region->hits;
+    rt->misses += region->misses;
+    rt->evictions += region->evictions;
+}
+
+bool regions_enabled(region_config* config)
+{
+    return config->warmup > 0 || config->use_markers
+        || config->num_ranges > 0;
+}
+
+bool parse_roi_range(const char* spec, region_config* config)
+{
+    long* range = config->ranges[config->num_ranges];
+    if (config->num_ranges == MAX_ROI_RANGES
+            || sscanf(spec, "%ld:%ld", &range[0], &range[1]) != 2
+            || range[0] < 0 || range[1] < range[0])
+        return false;
+    config->num_ranges += 1;
+    return true;
+}
+
+bool parse_roi_markers(const char* spec, region_config* config)
+{
+    if (sscanf(spec, "%" SCNx64 ":%" SCNx64, &config->marker_start,
+               &config->marker_end) != 2)
+        return false;
+    config->use_markers = true;
+    return true;
+}
+
+region_tracker* build_region_tracker(region_config* config)
+{
+    region_tracker* rt = calloc(1, sizeof(region_tracker));
+    if (rt == NULL)
+        return NULL;
+    rt->config = *config;
+    return rt;
+}
+
+void destroy_region_tracker(region_tracker* rt)
+{
+    free(rt->regions);
+    free(rt);
+}
+
+void region_begin_record(region_tracker* rt, cache_simulator* cache,
+                         long index, uint64_t address)
+{
+    if (rt->config.use_markers && address == rt->config.marker_start)
+        rt->in_markers = true;
+    if (! rt->counting && inside(rt, index)) {
+        open_region(rt, cache, index);
+    }
+    rt->filtered = rt->counting && rt->in_markers
+                   && address >= MARKER_STACK_FILTER;
+    if (rt->filtered) {
+        rt->skip_hits = cache->hit_count;
+        rt->skip_misses = cache->miss_count;
+        rt->skip_evictions = cache->eviction_count;
+    }
+}
+
+void region_end_record(region_tracker* rt, cache_simulator* cache,
+                       long index, uint64_t address)
+{
+    /* Leave the counts of a filtered record out of the open region. */
+    if (rt->filtered) {
+        rt->base_hits += cache->hit_count - rt->skip_hits;
+        rt->base_misses += cache->miss_count - rt->skip_misses;
+        rt->base_evictions += cache->eviction_count - rt->skip_evictions;
+        rt->filtered = false;
+    }
+    if (rt->config.use_markers && address == rt->config.marker_end)
+        rt->in_markers = false;
+    if (rt->counting && ! inside(rt, index + 1))
+        close_region(rt, cache, index);
+}
+
+void region_finish(region_tracker* rt, cache_simulator* cache, long index)
+{
+    if (rt->counting)
+        close_region(rt, cache, index);
+}
+
+void print_region_summary(region_tracker* rt)
+{
+    for (int i = 0; i < rt->num_regions; ++i) {
+        region_stats* region = &rt->regions[i];
+        printf("region %d records:%ld-%ld hits:%d misses:%d evictions:%d\n",
+               i, region->first, region->last, region->hits,
+               region->misses, region->evictions);
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * sectors.c
+ * Per sector valid and dirty bits for a sectored cache.
+ */
+#include "../include/sectors.h"
+#include "../include/cache_simulator.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+sector_map* build_sector_map(cache_simulator* cache, int sectors)
+{
+    int bits = 0;
+    while ((1 << bits) < sectors)
+        bits++;
+    if (sectors <= 0 || (1 << bits) != sectors || sectors > MAX_SECTORS
+            || bits > cache->offset_len) {
+        printf("ERROR: a block of %d bytes cannot be split into %d"
+               " sectors\n", 1 << cache->offset_len, sectors);
+        return NULL;
+    }
+    sector_map* sm = calloc(1, sizeof(sector_map));
+    if (sm == NULL) {
+        printf("Unable to allocate memory for sectors -- aborting.\n\n");
+        return NULL;
+    }
+    sm->sector_bits = bits;
+    sm->sector_offset_bits = cache->offset_len - bits;
+    sm->ways = cache->lines_per_set;
+    sm->page_bits = cache->page_bits;
+    sm->page_lines = cache->page_lines;
+    sm->num_pages = cache->num_pages;
+    sm->pages = calloc(sm->num_pages, sizeof(uint32_t*));
+    if (sm->pages == NULL) {
+        printf("Unable to allocate memory for sectors -- aborting.\n\n");
+        free(sm);
+        return NULL;
+    }
+    return sm;
+}
+
+void destroy_sector_map(sector_map* sm)
+{
+    for (int i = 0; i < sm->num_pages; ++i)
+        free(sm->pages[i]);
+    free(sm->pages);
+    free(sm);
+}
+
+/* Return the sectors of the line in way of set, allocating its page. */
+static uint32_t* line_sectors(sector_map* sm, int set, int way)
+{
+    uint32_t** page = &sm->pages[set >> sm->page_bits];
+    if (*page == NULL) {
+        *page = calloc(sm->page_lines, sizeof(uint32_t));
+        if (*page == NULL) {
+            printf("Unable to allocate memory for "
+                   "sectors -- aborting.\n\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    int set_in_page = set & ((1 << sm->page_bits) - 1);
+    return *page + set_in_page * sm->ways + way;
+}
+
+bool sector_access(sector_map* sm, int set, int way, unsigned offset,
+                   bool write)
+{
+    uint32_t* sectors = line_sectors(sm, set, way);
+    uint32_t bit = 1u << (offset >> sm->sector_offset_bits);
+    bool present = *sectors & bit;
+    if (! present) {
+        sm->sector_misses += 1;
+        sm->bytes_fetched += 1u << sm->sector_offset_bits;
+        *sectors |= bit;
+    }
+    if (write)
+        *sectors |= bit << MAX_SECTORS;
+    return present;
+}
+
+void sector_fill(sector_map* sm, int set, int way, unsigned offset,
+                 bool write, bool evicts, bool whole)
+{
+    uint32_t* sectors = line_sectors(sm, set, way);
+    if (evicts)
+        sm->bytes_written_back += (uint64_t)
+            __builtin_popcount(*sectors >> MAX_SECTORS)
+            << sm->sector_offset_bits;
+    if (whole) {
+        *sectors = (1u << (1 << sm->sector_bits)) - 1;
+        sm->bytes_fetched += 1u << (sm->sector_offset_bits
+                                    + sm->sector_bits);
+    } else {
+        sm->tag_misses += 1;
+        *sectors = 1u << (offset >> sm->sector_offset_bits);
+        sm->bytes_fetched += 1u << sm->sector_offset_bits;
+    }
+    if (write)
+        *sectors |= 1u << ((offset >> sm->sector_offset_bits) + MAX_SECTORS);
+}
+
+void print_sector_summary(sector_map* sm, int block_bits)
+{
+    printf("sectors sectors:%d sector-bytes:%d tag-misses:%lu"
+           " sector-misses:%lu bytes-fetched:%" PRIu64
+           " bytes-written-back:%" PRIu64 " block-cache-bytes:%" PRIu64 "\n",
+           1 << sm->sector_bits, 1 << sm->sector_offset_bits,
+           sm->tag_misses, sm->sector_misses, sm->bytes_fetched,
+           sm->bytes_written_back, (uint64_t) sm->tag_misses << block_bits);
+}
@@ -0,0 +1,702 @@
+/*
+ * simulation.c
+ * A single cache simulation run.
+ */
+#include "../include/simulation.h"
+#include "../include/cachelab.h"
+#include "../include/instruction_reader.h"
+#include "../include/prefetcher.h"
+#include "../include/victim_cache.h"
+#include "../include/sectors.h"
+#include "../include/dueling.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+/* Build the cache, or restore it along with our place in the trace. */
+static bool build_cache(simulation* sim)
+{
+    program_args* args = sim->args;
+    if (args->restore_filename) {
+        sim->cache = load_checkpoint(args->restore_filename, &sim->position);
+        if (! sim->cache)
+            return false;
+        if ((args->b > 0 && args->b != sim->cache->offset_len)
+                || (args->E > 0 && args->E != sim->cache->lines_per_set)
+                || (args->s > 0 && (1 << args->s) != sim->cache->num_sets)) {
+            printf("ERROR: %s was taken with a different cache shape\n",
+                   args->restore_filename);
+            return false;
+        }
+        if ((args->policy_given && args->policy != sim->cache->policy)
+                || (args->index_given
+                    && args->index_fn != sim->cache->index_fn)
+                || (args->num_sets > 0
+                    && args->num_sets != sim->cache->num_sets)) {
+            printf("ERROR: %s was taken with a different replacement"
+                   " policy, index function or number of sets\n",
+                   args->restore_filename);
+            return false;
+        }
+        if (fseek(sim->trace, sim->position.trace_offset, SEEK_SET) != 0) {
+            printf("ERROR: Failed to seek in reference file: %s\n",
+                   args->ref_filename);
+            return false;
+        }
+    } else {
+        int num_sets = args->num_sets > 0 ? args->num_sets : 1 << args->s;
+        sim->cache = build_indexed_simulator(args->b, num_sets, args->E,
+                                             args->index_fn);
+        if (! sim->cache) {
+            printf("Unable to allocate memory for "
+                   "cache simulator -- aborting.\n\n");
+            return false;
+        }
+        if (! set_replacement_policy(sim->cache, args->policy)) {
+            printf("Unable to allocate memory for "
+                   "set dueling -- aborting.\n\n");
+            return false;
+        }
+    }
+    if (args->prefetch != PREFETCH_NONE) {
+        sim->cache->prefetcher = build_prefetcher(args->prefetch,
+                args->prefetch_degree, args->prefetch_latency);
+        if (! sim->cache->prefetcher) {
+            printf("Unable to allocate memory for "
+                   "prefetcher -- aborting.\n\n");
+            return false;
+        }
+    }
+    if (args->victim_entries > 0) {
+        sim->cache->victim_cache = build_victim_cache(args->victim,
+                args->victim_entries);
+        if (! sim->cache->victim_cache) {
+            printf("Unable to allocate memory for "
+                   "victim cache -- aborting.\n\n");
+            return false;
+        }
+    }
+    if (args->sectors > 0) {
+        sim->cache->sectors = build_sector_map(sim->cache, args->sectors);
+        if (! sim->cache->sectors)
+            return false;
+    }
+    if (args->tenants) {
+        sim->cache->tenants = build_tenant_table(args->way_masks,
+                sim->cache->lines_per_set);
+        if (! sim->cache->tenants)
+            return false;
+    }
+    return true;
+}
+
+/* Build the TLB, regions, timing model, logs and reducer asked for. */
+static bool build_models(simulation* sim)
+{
+    program_args* args = sim->args;
+    if (args->num_tlb_levels > 0) {
+        sim->dtlb = build_tlb(args->tlb_levels, args->num_tlb_levels,
+                              args->page_bits, args->walk_latency);
+        if (! sim->dtlb) {
+            printf("Unable to allocate memory for "
+                   "TLB -- aborting.\n\n");
+            return false;
+        }
+    }
+    if (regions_enabled(&args->regions)) {
+        sim->rt = build_region_tracker(&args->regions);
+        if (! sim->rt) {
+            printf("Unable to allocate memory for "
+                   "regions -- aborting.\n\n");
+            return false;
+        }
+    }
+    if (args->timing) {
+        /* the levels are the cache, then the victim cache if attached */
+        timing_config config = args->timing_config;
+        if (! sim->cache->victim_cache)
+            config.num_levels = 1;
+        else if (config.num_levels == 1)
+            config.hit_latency[config.num_levels++] =
+                config.hit_latency[0] + 2;
+        sim->tm = build_timing_model(&config);
+        if (! sim->tm) {
+            printf("Unable to allocate memory for "
+                   "timing model -- aborting.\n\n");
+            return false;
+        }
+    }
+    if (sim->cache->policy == REPLACE_OPT) {
+        sim->opt = build_opt_oracle(sim->cache, sim->trace, args->reduce);
+        if (! sim->opt)
+            return false;
+    }
+    if (args->conflict_bits > 0) {
+        sim->conflicts = build_conflict_analyzer(args->conflict_bits);
+        if (! sim->conflicts) {
+            printf("Unable to allocate memory for "
+                   "conflict analyzer -- aborting.\n\n");
+            return false;
+        }
+    }
+    if (args->heatmap) {
+        sim->heat = build_heatmap(sim->cache->num_sets, args->heatmap_bits,
+                                  args->symbols_file);
+        if (! sim->heat)
+            return false;
+    }
+    if (args->event_log) {
+        sim->log = open_event_log(args->event_log, sim->cache);
+        if (! sim->log)
+            return false;
+    }
+    if (args->reduce) {
+        /* with sectors a run must stay in one sector to only hit */
+        sim->reducer = build_trace_reducer(sim->trace, sim->cache->sectors
+                ? sim->cache->sectors->sector_offset_bits
+                : sim->cache->offset_len);
+        if (! sim->reducer) {
+            printf("Unable to allocate memory for "
+                   "trace reducer -- aborting.\n\n");
+            return false;
+        }
+    }
+    if (args->reduce_out) {
+        sim->reduce_out = fopen(args->reduce_out, "w");
+        if (! sim->reduce_out) {
+            printf("ERROR: Failed to create reduced trace: %s\n",
+                   args->reduce_out);
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Load (or build) the trace's sidecar index, then seek to the first record
+ * asked for and parse the trace up front if asked to.
+ */
+static bool use_index(simulation* sim)
+{
+    program_args* args = sim->args;
+    if (args->build_index > 0) {
+        sim->index = build_trace_index(args->ref_filename, args->build_index);
+        if (! sim->index)
+            return false;
+        if (! save_trace_index(sim->index, args->ref_filename))
+            printf("ERROR: Failed to write trace index: %s%s\n",
+                   args->ref_filename, TRACE_INDEX_SUFFIX);
+    } else if (args->start_at > 0 || args->parse_threads > 0
+               || args->simpoints_file) {
+        /* an index is only built the first time it is needed */
+        sim->index = load_trace_index(args->ref_filename);
+        if (! sim->index) {
+            sim->index = build_trace_index(args->ref_filename,
+                                           DEFAULT_INDEX_STRIDE);
+            if (! sim->index)
+                return false;
+            save_trace_index(sim->index, args->ref_filename);
+        }
+    }
+    if (args->start_at > 0) {
+        if (! seek_trace_record(sim->index, sim->trace, args->start_at)) {
+            printf("ERROR: %s has fewer than %ld records\n",
+                   args->ref_filename, args->start_at);
+            return false;
+        }
+        sim->position.records = args->start_at;
+    }
+    if (args->parse_threads > 0) {
+        long count = sim->index->header.num_records - args->start_at;
+        if (args->max_records >= 0 && args->max_records < count)
+            count = args->max_records;
+        sim->parsed = malloc((count > 0 ? count : 1) * sizeof(instruction));
+        if (! sim->parsed) {
+            printf("Unable to allocate memory for "
+                   "parsed trace -- aborting.\n\n");
+            return false;
+        }
+        if (! parse_trace_parallel(sim->index, args->ref_filename,
+                                   args->start_at, count, sim->parsed,
+                                   args->parse_threads))
+            return false;
+        sim->num_parsed = count;
+    }
+    return true;
+}
+
+/* Read the next trace record, through the reducer if there is one. */
+static int read_record(simulation* sim, instruction* inst)
+{
+    if (sim->args->max_records >= 0
+            && sim->records - sim->first_record >= sim->args->max_records)
+        return 0;
+    if (sim->parsed) {
+        if (sim->next_parsed == sim->num_parsed)
+            return 0;
+        *inst = sim->parsed[sim->next_parsed++];
+        return 1;
+    }
+    if (sim->mux)
+        return mux_read_instruction(sim->mux, inst);
+    if (sim->reducer)
+        return reduce_instruction(sim->reducer, inst);
+    return read_instruction(sim->trace, inst);
+}
+
+/*
+ * Read the next trace record, stopping the run at a stream that cannot be
+ * told apart from the tenants below it.
+ */
+static int next_record(simulation* sim, instruction* inst)
+{
+    if (! read_record(sim, inst))
+        return 0;
+    if (sim->cache->tenants && inst->stream >= MAX_TENANTS) {
+        printf("ERROR: record %ld is from stream %u, but there can be at"
+               " most %d tenants\n", sim->records, inst->stream,
+               MAX_TENANTS);
+        sim->failed = true;
+        return 0;
+    }
+    return 1;
+}
+
+/* Save a checkpoint of the cache at the current trace position. */
+static void checkpoint(simulation* sim, int inst_no)
+{
+    sim->position.trace_offset = ftell(sim->trace);
+    sim->position.inst_no = inst_no;
+    sim->position.records = sim->records;
+    if (! save_checkpoint(sim->cache, &sim->position,
+                          sim->args->checkpoint_out))
+        printf("ERROR: Failed to write checkpoint: %s\n",
+               sim->args->checkpoint_out);
+}
+
+/* Count hits that did not need a lookup, for the tenant too if any. */
+static void count_hits(cache_simulator* cache, int hits)
+{
+    cache->hit_count += hits;
+    if (cache->tenants)
+        cache->tenants->stats[cache->tenants->current].hits += hits;
+}
+
+/* Simulate one trace record, and the accesses folded into it. */
+static void simulate_record(simulation* sim, instruction* instr)
+{
+    program_args* args = sim->args;
+    cache_simulator* cache = sim->cache;
+    op_state result1;
+    address_info addr;
+
+    if (sim->reduce_out)
+        write_instruction(sim->reduce_out, instr);
+    if (sim->rt)
+        region_begin_record(sim->rt, cache, sim->records, instr->address);
+
+    /* Fill address_info */
+    get_address_info(instr->address, &addr, cache);
+    if (cache->tenants)
+        tenant_begin_access(cache->tenants, instr->stream);
+
+    /*
+     * If the op is a modify, we know that the second cache check with be a
+     * hit.
+     */
+    if (instr->op == 'M') {
+        sim->inst_no += 1;
+        count_hits(cache, 1);
+    }
+
+    /* test the cache */
+    cache->writing = instr->op != 'L';
+    if (sim->opt)
+        cache->next_use = opt_next_use(sim->opt);
+    unsigned long victim_hits = cache->victim_cache
+                                ? cache->victim_cache->hits : 0;
+    result1 = check_cache(cache, &addr, sim->inst_no);
+    if (sim->conflicts && result1 == CACHE_EVICTION)
+        conflict_record(sim->conflicts,
+                get_block_address(cache, &addr) << cache->offset_len,
+                cache->last_victim_block << cache->offset_len,
+                addr.set_index);
+    if (sim->heat) {
+        heatmap_access(sim->heat, addr.set_index, instr->address,
+                       (instr->op == 'M' ? 2 : 1) * (1 + instr->repeat),
+                       result1);
+        if (result1 == CACHE_EVICTION)
+            heatmap_evicted(sim->heat,
+                    cache->last_victim_block << cache->offset_len);
+    }
+    int tlb_level = 0;
+    if (sim->dtlb)
+        tlb_level = tlb_access(sim->dtlb, instr->address, sim->inst_no);
+
+    if (sim->tm) {
+        int level = 0, walk = 0;
+        if (result1 != CACHE_HIT)
+            level = cache->victim_cache
+                    && cache->victim_cache->hits > victim_hits
+                    ? 1 : sim->tm->config.num_levels;
+        if (sim->dtlb && tlb_level == sim->dtlb->num_levels)
+            walk = sim->dtlb->walk_levels * sim->dtlb->walk_latency;
+        timing_access(sim->tm, get_block_address(cache, &addr), level, walk);
+        if (instr->op == 'M')
+            timing_access(sim->tm, get_block_address(cache, &addr), 0, 0);
+    }
+
+    /* the accesses folded into this one all hit */
+    for (unsigned i = 0; i < instr->repeat; ++i) {
+        int hits = instr->op == 'M' ? 2 : 1;
+        sim->inst_no += hits;
+        count_hits(cache, hits);
+        if (cache->policy != REPLACE_OPT)
+            touch_block(cache, &addr, sim->inst_no);
+        if (sim->dtlb)
+            tlb_access(sim->dtlb, instr->address, sim->inst_no);
+        for (int j = 0; sim->tm && j < hits; ++j)
+            timing_access(sim->tm, get_block_address(cache, &addr), 0, 0);
+    }
+
+    /* Print results */
+    if (args->verbose)
+        log_text_access(-1, instr->op, instr->address, instr->size,
+                        result1);
+    if (sim->log)
+        log_event(sim->log, sim->records, instr->op, addr.set_index,
+                  result1, cache->last_victim.tag);
+    if (sim->rt)
+        region_end_record(sim->rt, cache, sim->records + instr->repeat,
+                          instr->address);
+
+    /* save a checkpoint once enough of the trace has been seen */
+    long first = sim->records;
+    sim->records += 1 + instr->repeat;
+    if (sim->intervals.length > 0)
+        interval_record(&sim->intervals, sim->records, cache->hit_count,
+                        cache->miss_count, cache->eviction_count);
+    if (args->checkpoint_out && first < args->checkpoint_at
+            && sim->records >= args->checkpoint_at)
+        checkpoint(sim, sim->inst_no + 1);
+}
+
+simulation* build_simulation(program_args* args)
+{
+    simulation* sim = calloc(1, sizeof(simulation));
+    if (sim == NULL) {
+        printf("Unable to allocate memory for "
+               "simulation -- aborting.\n\n");
+        return NULL;
+    }
+    sim->args = args;
+    if (args->verbose)
+        start_text_log();
+
+    /* the traces of several tenants are interleaved into one */
+    if (args->num_traces > 1) {
+        if (args->checkpoint_out || args->restore_filename || args->reduce
+                || args->build_index > 0 || args->start_at > 0
+                || args->parse_threads > 0 || args->policy == REPLACE_OPT
+                || args->conflict_bits > 0) {
+            printf("ERROR: interleaved tenant traces do not support"
+                   " checkpoints, reduction, indexes, OPT or conflict"
+                   " analysis\n");
+            free(sim);
+            return NULL;
+        }
+        sim->mux = open_trace_mux(args->trace_files, args->num_traces,
+                                  args->quantum);
+        if (! sim->mux) {
+            free(sim);
+            return NULL;
+        }
+        set_mux_schedule(sim->mux, args->schedule, args->num_schedule);
+        if (! build_cache(sim) || ! build_models(sim)) {
+            destroy_simulation(sim);
+            return NULL;
+        }
+        init_intervals(&sim->intervals, args->interval, 0, 0, 0, 0);
+        return sim;
+    }
+
+    // load valgrind reference file
+    sim->trace = open_trace(args->ref_filename);
+    if (! sim->trace) {
+        printf("ERROR: Failed to open reference file: %s\n",
+               args->ref_filename);
+        free(sim);
+        return NULL;
+    }
+    if (sim->trace == stdin
+            && (args->checkpoint_out || args->restore_filename)) {
+        printf("ERROR: checkpoints need a trace file, not stdin\n");
+        destroy_simulation(sim);
+        return NULL;
+    }
+    if (args->reduce && (args->checkpoint_out || regions_enabled(&args->regions)
+            || (args->prefetch != PREFETCH_NONE
+                && args->prefetch_latency > 0))) {
+        printf("ERROR: checkpoints, regions and prefetches that take time"
+               " to arrive are not supported while reducing a trace\n");
+        destroy_simulation(sim);
+        return NULL;
+    }
+    if ((sim->trace == stdin && (args->build_index > 0 || args->start_at > 0
+                                 || args->parse_threads > 0))
+            || (args->restore_filename && args->start_at > 0)
+            || (args->parse_threads > 0
+                && (args->reduce || args->checkpoint_out))) {
+        printf("ERROR: indexed traces need a trace file, and cannot be"
+               " started mid-trace from a checkpoint or parsed in parallel"
+               " while reducing or saving checkpoints\n");
+        destroy_simulation(sim);
+        return NULL;
+    }
+    if (args->conflict_bits > 0 && (sim->trace == stdin
+            || args->policy == REPLACE_OPT || args->restore_filename
+            || regions_enabled(&args->regions)
+            || args->prefetch != PREFETCH_NONE || args->sectors > 0
+            || args->tenants || args->victim_entries > 0)) {
+        printf("ERROR: conflict analysis simulates the trace again from a"
+               " cold plain cache, so it needs a trace file and cannot use"
+               " OPT, checkpoints, regions, prefetchers, sectors, tenants"
+               " or a victim or miss cache\n");
+        destroy_simulation(sim);
+        return NULL;
+    }
+    if (args->simpoints_file && (sim->trace == stdin
+            || args->checkpoint_out || args->restore_filename
+            || args->reduce || args->start_at > 0 || args->max_records >= 0
+            || args->parse_threads > 0 || regions_enabled(&args->regions)
+            || args->policy == REPLACE_OPT)) {
+        printf("ERROR: simpoints need a trace file to seek in, and choose"
+               " the records to simulate themselves\n");
+        destroy_simulation(sim);
+        return NULL;
+    }
+    if (args->sectors > 0 && (args->checkpoint_out || args->restore_filename
+                              || args->index_fn == INDEX_SKEWED
+                              || args->policy == REPLACE_OPT)) {
+        printf("ERROR: sectored caches do not work with checkpoints, skewed"
+               " indexing or OPT\n");
+        destroy_simulation(sim);
+        return NULL;
+    }
+    if (args->policy == REPLACE_OPT && (sim->trace == stdin
+            || args->restore_filename || args->prefetch != PREFETCH_NONE
+            || args->index_fn == INDEX_SKEWED)) {
+        printf("ERROR: OPT needs a trace file it can read ahead, and does"
+               " not work with checkpoints, prefetchers or skewed"
+               " indexing\n");
+        destroy_simulation(sim);
+        return NULL;
+    }
+    if (args->tenants && (args->restore_filename
+                          || (args->policy == REPLACE_OPT
+                              && way_masks_given(args->way_masks)))) {
+        printf("ERROR: tenants cannot start from a checkpoint, and way"
+               " masks do not work with OPT\n");
+        destroy_simulation(sim);
+        return NULL;
+    }
+    if ((args->policy == REPLACE_DIP || args->policy == REPLACE_DRRIP)
+            && ! args->restore_filename
+            && (args->num_sets > 0 ? args->num_sets : 1 << args->s)
+               < DUELING_MIN_SETS) {
+        printf("ERROR: DIP and DRRIP need at least %d sets to duel\n",
+               DUELING_MIN_SETS);
+        destroy_simulation(sim);
+        return NULL;
+    }
+    if (args->simpoints_file
+            && ! (sim->phases = read_simpoints(args->simpoints_file))) {
+        destroy_simulation(sim);
+        return NULL;
+    }
+    if (! build_cache(sim) || ! use_index(sim) || ! build_models(sim)) {
+        destroy_simulation(sim);
+        return NULL;
+    }
+    sim->records = sim->first_record = sim->position.records;
+    sim->inst_no = sim->position.inst_no;
+    init_intervals(&sim->intervals, args->interval, sim->records,
+                   sim->cache->hit_count, sim->cache->miss_count,
+                   sim->cache->eviction_count);
+    return sim;
+}
+
+/*
+ * Simulate only the simpoints, each after a warmup of the records before
+ * it, and count what each of them saw.
+ */
+static void run_simpoints(simulation* sim)
+{
+    cache_simulator* cache = sim->cache;
+    phase_profile* pp = sim->phases;
+    long warmup = sim->args->simpoint_warmup >= 0
+                  ? sim->args->simpoint_warmup : pp->interval_length;
+    long record = 0;
+    bool more = true;
+    instruction instr;
+
+    for (int i = 0; more && i < pp->num_points; ++i) {
+        simpoint* sp = &pp->points[i];
+        /* skip to the warmup, unless it overlaps the last simpoint */
+        if (sp->first - warmup > record) {
+            record = sp->first - warmup;
+            if (! seek_trace_record(sim->index, sim->trace, record))
+                break;
+            sim->records = record;
+        }
+        for (; record < sp->first && (more = next_record(sim, &instr));
+             ++record, sim->inst_no++) {
+            simulate_record(sim, &instr);
+            pp->simulated_records += 1;
+        }
+        int hits = cache->hit_count, misses = cache->miss_count;
+        int evictions = cache->eviction_count;
+        long first = record;
+        for (; more && record < sp->first + sp->records
+                    && (more = next_record(sim, &instr));
+             ++record, sim->inst_no++) {
+            simulate_record(sim, &instr);
+            pp->simulated_records += 1;
+        }
+        if (record == first)
+            break;
+        sp->hits = cache->hit_count - hits;
+        sp->misses = cache->miss_count - misses;
+        sp->evictions = cache->eviction_count - evictions;
+        sp->records = record - first;
+        sp->simulated = true;
+    }
+}
+
+bool run_simulation(simulation* sim)
+{
+    program_args* args = sim->args;
+    cache_simulator* cache = sim->cache;
+    instruction instr;
+
+    // read through the instructions and process them
+    if (sim->phases)
+        run_simpoints(sim);
+    for (; ! sim->phases && next_record(sim, &instr); sim->inst_no++)
+        simulate_record(sim, &instr);
+    if (args->checkpoint_out && args->checkpoint_at < 0)
+        checkpoint(sim, sim->inst_no);
+
+    if (sim->reduce_out) {
+        if (fclose(sim->reduce_out) != 0)
+            printf("ERROR: Failed to write reduced trace: %s\n",
+                   args->reduce_out);
+        sim->reduce_out = NULL;
+    }
+    if (sim->log) {
+        if (! close_event_log(sim->log))
+            printf("ERROR: Failed to write event log: %s\n",
+                   args->event_log);
+        sim->log = NULL;
+    }
+    interval_finish(&sim->intervals, sim->records, cache->hit_count,
+                    cache->miss_count, cache->eviction_count);
+    if (sim->rt)
+        region_finish(sim->rt, cache, sim->records - 1);
+    if (sim->heat && args->heatmap_out
+            && ! write_heatmap(sim->heat, args->heatmap_out))
+        printf("ERROR: Failed to write heatmap: %s\n", args->heatmap_out);
+    if (sim->conflicts && ! analyze_conflicts(sim->conflicts, cache,
+            args->ref_filename, sim->first_record, args->max_records)) {
+        destroy_conflict_analyzer(sim->conflicts);
+        sim->conflicts = NULL;
+    }
+    return ! sim->failed;
+}
+
+void simulation_totals(simulation* sim, int* hits, int* misses,
+                       int* evictions)
+{
+    if (sim->phases) {
+        estimate_phase_totals(sim->phases, hits, misses, evictions);
+    } else if (sim->rt) {
+        *hits = sim->rt->hits;
+        *misses = sim->rt->misses;
+        *evictions = sim->rt->evictions;
+    } else {
+        *hits = sim->cache->hit_count;
+        *misses = sim->cache->miss_count;
+        *evictions = sim->cache->eviction_count;
+    }
+}
+
+void print_simulation_summary(simulation* sim)
+{
+    cache_simulator* cache = sim->cache;
+    int hits, misses, evictions;
+
+    // print the results, only counting the regions of interest if given
+    simulation_totals(sim, &hits, &misses, &evictions);
+    printSummary(hits, misses, evictions);
+    if (sim->phases)
+        print_simpoint_summary(sim->phases);
+    if (sim->rt)
+        print_region_summary(sim->rt);
+    if (sim->reducer)
+        print_reduction_summary(sim->reducer);
+    if (cache->prefetcher)
+        print_prefetch_summary(cache->prefetcher);
+    if (cache->sectors)
+        print_sector_summary(cache->sectors, cache->offset_len);
+    if (cache->dueling)
+        print_dueling_summary(cache->dueling);
+    if (cache->victim_cache)
+        print_victim_summary(cache->victim_cache);
+    if (sim->dtlb)
+        print_tlb_summary(sim->dtlb);
+    if (sim->tm)
+        print_timing_summary(sim->tm);
+    if (cache->tenants)
+        print_tenant_summary(cache->tenants);
+    if (sim->heat)
+        print_heatmap_top(sim->heat, sim->args->heatmap_top);
+    if (sim->conflicts)
+        print_conflict_report(sim->conflicts);
+    if (sim->args->memory_report)
+        print_memory_summary(cache);
+}
+
+void destroy_simulation(simulation* sim)
+{
+    if (sim->trace)
+        close_trace(sim->trace);
+    if (sim->mux)
+        close_trace_mux(sim->mux);
+    if (sim->reduce_out)
+        fclose(sim->reduce_out);
+    if (sim->log)
+        close_event_log(sim->log);
+    if (sim->reducer)
+        destroy_trace_reducer(sim->reducer);
+    if (sim->index)
+        destroy_trace_index(sim->index);
+    if (sim->opt)
+        destroy_opt_oracle(sim->opt);
+    if (sim->conflicts)
+        destroy_conflict_analyzer(sim->conflicts);
+    if (sim->heat)
+        destroy_heatmap(sim->heat);
+    if (sim->phases)
+        destroy_phase_profile(sim->phases);
+    free(sim->parsed);
+    if (sim->rt)
+        destroy_region_tracker(sim->rt);
+    if (sim->dtlb)
+        destroy_tlb(sim->dtlb);
+    if (sim->tm)
+        destroy_timing_model(sim->tm);
+    if (sim->cache)
+        destroy_simulator(sim->cache);
+    free(sim);
+}
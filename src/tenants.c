@@ -0,0 +1,101 @@
+/*
+ * tenants.c
+ * Per tenant way masks and statistics.
+ */
+#include "../include/tenants.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+bool parse_way_mask(const char* spec, uint64_t* masks)
+{
+    int tenant;
+    uint64_t mask;
+    if (sscanf(spec, "%d:%" SCNx64, &tenant, &mask) != 2 || tenant < 0
+            || tenant >= MAX_TENANTS || mask == 0)
+        return false;
+    masks[tenant] = mask;
+    return true;
+}
+
+bool way_masks_given(uint64_t* masks)
+{
+    for (int i = 0; i < MAX_TENANTS; ++i) {
+        if (masks[i] != 0)
+            return true;
+    }
+    return false;
+}
+
+tenant_table* build_tenant_table(uint64_t* masks, int ways)
+{
+    uint64_t all = ways >= MAX_MASK_WAYS ? ~0ULL : (1ULL << ways) - 1;
+    for (int i = 0; i < MAX_TENANTS; ++i) {
+        if (masks[i] != 0 && ways > MAX_MASK_WAYS) {
+            printf("ERROR: way masks cover at most %d ways\n",
+                   MAX_MASK_WAYS);
+            return NULL;
+        }
+        if (masks[i] != 0 && (masks[i] & all) == 0) {
+            printf("ERROR: the way mask of tenant %d allows none of the %d"
+                   " ways\n", i, ways);
+            return NULL;
+        }
+    }
+    tenant_table* tt = calloc(1, sizeof(tenant_table));
+    if (tt == NULL) {
+        printf("Unable to allocate memory for tenants -- aborting.\n\n");
+        return NULL;
+    }
+    for (int i = 0; i < MAX_TENANTS; ++i)
+        tt->way_masks[i] = masks[i] ? masks[i] & all : all;
+    return tt;
+}
+
+void destroy_tenant_table(tenant_table* tt)
+{
+    free(tt);
+}
+
+void tenant_begin_access(tenant_table* tt, unsigned tenant)
+{
+    tt->current = tenant;
+    if (tt->current >= tt->num_tenants)
+        tt->num_tenants = tt->current + 1;
+    tt->accesses += 1;
+    for (int i = 0; i < tt->num_tenants; ++i)
+        tt->stats[i].occupancy_sum += tt->stats[i].occupancy;
+}
+
+uint64_t tenant_way_mask(tenant_table* tt)
+{
+    return tt->way_masks[tt->current];
+}
+
+void tenant_fill(tenant_table* tt, bool evicts, int victim_owner)
+{
+    if (evicts) {
+        tt->stats[victim_owner].occupancy -= 1;
+        if (victim_owner != tt->current)
+            tt->stats[victim_owner].interference += 1;
+    }
+    tt->stats[tt->current].occupancy += 1;
+}
+
+void tenant_release(tenant_table* tt, int owner)
+{
+    tt->stats[owner].occupancy -= 1;
+}
+
+void print_tenant_summary(tenant_table* tt)
+{
+    for (int i = 0; i < tt->num_tenants; ++i) {
+        tenant_stats* ts = &tt->stats[i];
+        double mean = tt->accesses ? ts->occupancy_sum / tt->accesses : 0;
+        printf("tenant %d ways:%" PRIx64 " hits:%d misses:%d evictions:%d"
+               " evicted-by-others:%d occupancy:%ld mean-occupancy:%.1f\n",
+               i, tt->way_masks[i], ts->hits, ts->misses, ts->evictions,
+               ts->interference, ts->occupancy, mean);
+    }
+}
@@ -1,8 +1,11 @@
 /*
  * test-trans.c - Checks the correctness and performance of all of the
  *     student's transpose functions and records the results for their
- *     official submitted version as well.
+ *     official submitted version as well. With -b the registered functions
+ *     are also timed natively so the simulated misses can be compared
+ *     with real throughput.
  */
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -14,6 +17,7 @@
 #include "../include/cachelab.h"
 #include <sys/wait.h> // fir WEXITSTATUS
 #include <limits.h> // for INT_MAX
+#include <time.h> // for clock_gettime
 
 /* Maximum array dimension */
 #define MAXN 256
@@ -22,16 +26,23 @@
    student submits for credit */
 #define SUBMIT_DESCRIPTION "Transpose submission"
 
-/* External function defined in trans.c */
+/* External functions defined in trans.c */
 extern void registerFunctions();
+extern void registerNativeFunctions();
 
 /* External variables defined in cachelab-tools.c */
 extern trans_func_t func_list[MAX_TRANS_FUNCS];
 extern int func_counter; 
 
+/* Default number of timed iterations in benchmark mode */
+#define BENCH_ITERATIONS 1000
+
 /* Globals set on the command line */
 static int M = 0;
 static int N = 0;
+static int benchmark = 0;
+static int simulate = 1;
+static int iterations = BENCH_ITERATIONS;
 
 /* The correctness and performance for the submitted transpose function */
 struct results {
@@ -52,8 +63,6 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
     char buf[1000], cmd[255];
     char filename[128];
 
-    registerFunctions(); 
-
     /* Open the complete trace file */
     FILE* full_trace_fp;  
     FILE* part_trace_fp; 
@@ -160,15 +169,76 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
   
 }
 
+/* Return the current time of the monotonic clock in nanoseconds. */
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * eval_native - Time each registered transpose function on the host.
+ *     Every function is run for a tenth of the iterations to warm the
+ *     caches and branch predictors before the timed iterations.
+ */
+void eval_native(int iters)
+{
+    int i, k, correct;
+    int warmup = iters / 10 + 1;
+    double start, elapsed, ns_per_elem, gbps;
+    int (*A)[M] = malloc(sizeof(int[N][M]));
+    int (*B)[N] = malloc(sizeof(int[M][N]));
+    int (*C)[N] = malloc(sizeof(int[M][N]));
+    assert(A && B && C);
+
+    initMatrix(M, N, A, B);
+    correctTrans(M, N, A, C);
+
+    printf("\nNative benchmark (%dx%d, %d iterations, %d warmup)\n",
+           M, N, iters, warmup);
+    printf("%4s %-40s %8s %10s %8s\n",
+           "func", "description", "misses", "ns/elem", "GB/s");
+    for (i = 0; i < func_counter; i++) {
+        for (k = 0; k < warmup; k++)
+            (*func_list[i].func_ptr)(M, N, A, B);
+        correct = memcmp(B, C, sizeof(int[M][N])) == 0;
+
+        start = now_ns();
+        for (k = 0; k < iters; k++)
+            (*func_list[i].func_ptr)(M, N, A, B);
+        elapsed = now_ns() - start;
+
+        /* Every element is read from A once and written to B once. */
+        ns_per_elem = elapsed / ((double) iters * M * N);
+        gbps = 2.0 * sizeof(int) * M * N * iters / elapsed;
+        if (func_list[i].correct)
+            printf("%4d %-40s %8u %10.3f %8.2f%s\n", i,
+                   func_list[i].description, func_list[i].num_misses,
+                   ns_per_elem, gbps, correct ? "" : "  (incorrect)");
+        else
+            printf("%4d %-40s %8s %10.3f %8.2f%s\n", i,
+                   func_list[i].description, "-",
+                   ns_per_elem, gbps, correct ? "" : "  (incorrect)");
+    }
+    free(A);
+    free(B);
+    free(C);
+}
+
 /*
  * usage - Print usage info
  */
 void usage(char *argv[]){
-    printf("Usage: %s [-h] -M <rows> -N <cols>\n", argv[0]);
+    printf("Usage: %s [-hbS] [-i <iters>] -M <rows> -N <cols>\n", argv[0]);
     printf("Options:\n");
     printf("  -h          Print this help message.\n");
     printf("  -M <rows>   Number of matrix rows (max %d)\n", MAXN);
     printf("  -N <cols>   Number of  matrix columns (max %d)\n", MAXN);
+    printf("  -b          Also time each function natively.\n");
+    printf("  -i <iters>  Timed iterations per function (default %d)\n",
+           BENCH_ITERATIONS);
+    printf("  -S          Skip the simulated evaluation (implies -b)\n");
     printf("Example: %s -M 8 -N 8\n", argv[0]);       
 }
 
@@ -199,7 +269,7 @@ int main(int argc, char* argv[])
 {
     char c;
 
-    while ((c = getopt(argc,argv,"M:N:h")) != -1) {
+    while ((c = getopt(argc,argv,"M:N:hbi:S")) != -1) {
         switch(c) {
         case 'M':
             M = atoi(optarg);
@@ -207,6 +277,16 @@ int main(int argc, char* argv[])
         case 'N':
             N = atoi(optarg);
             break;
+        case 'b':
+            benchmark = 1;
+            break;
+        case 'i':
+            iterations = atoi(optarg);
+            break;
+        case 'S':
+            simulate = 0;
+            benchmark = 1;
+            break;
         case 'h':
             usage(argv);
             exit(0);
@@ -228,6 +308,12 @@ int main(int argc, char* argv[])
         exit(1);
     }
 
+    if (iterations <= 0) {
+        printf("Error: iterations must be positive\n");
+        usage(argv);
+        exit(1);
+    }
+
     /* Install SIGSEGV and SIGALRM handlers */
     if (signal(SIGSEGV, sigsegv_handler) == SIG_ERR) {
         fprintf(stderr, "Unable to install SIGALRM handler\n");
@@ -242,10 +328,22 @@ int main(int argc, char* argv[])
     /* Time out and give up after a while */
     alarm(120);
 
+    registerFunctions();
+
     /* Check the performance of the student's transpose function */
-    eval_perf(5, 1, 5);
-  
+    if (simulate)
+        eval_perf(5, 1, 5);
+
+    /* Time the functions natively, with a fresh timeout */
+    if (benchmark) {
+        alarm(120);
+        registerNativeFunctions();
+        eval_native(iterations);
+    }
+
     /* Emit the results for this particular test */
+    if (! simulate)
+        return 0;
     if (results.funcid == -1) {
         printf("\nError: We could not find your transpose_submit() function\n");
         printf("Error: Please ensure that description field is exactly \"%s\"\n", 
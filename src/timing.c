@@ -0,0 +1,142 @@
+/*
+ * timing.c
+ * An MSHR limited timing model.
+ */
+#include "../include/timing.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* Release every MSHR whose miss has completed by cycle. */
+static void retire_mshrs(timing_model* tm, uint64_t cycle)
+{
+    for (int i = 0; i < tm->active_mshrs; ) {
+        if (tm->mshrs[i].done <= cycle)
+            tm->mshrs[i] = tm->mshrs[--tm->active_mshrs];
+        else
+            i++;
+    }
+}
+
+/* Start a miss to memory for block at cycle, returning when it completes. */
+static uint64_t start_miss(timing_model* tm, uint64_t block, uint64_t cycle)
+{
+    uint64_t start = cycle, done;
+    if (tm->config.transfer_cycles > 0) {
+        if (tm->bus_free > start)
+            start = tm->bus_free;
+        tm->bus_free = start + tm->config.transfer_cycles;
+    }
+    done = start + tm->config.memory_latency;
+    tm->mshrs[tm->active_mshrs].block = block;
+    tm->mshrs[tm->active_mshrs].done = done;
+    tm->active_mshrs += 1;
+    tm->misses += 1;
+
+    /* grow the union of the miss intervals */
+    tm->miss_cycles += done - cycle;
+    if (cycle >= tm->busy_until)
+        tm->busy_cycles += done - cycle;
+    else if (done > tm->busy_until)
+        tm->busy_cycles += done - tm->busy_until;
+    if (done > tm->busy_until)
+        tm->busy_until = done;
+    return done;
+}
+
+bool parse_hit_latencies(const char* spec, timing_config* config)
+{
+    const char* curr = spec;
+    char* end;
+    config->num_levels = 0;
+    while (config->num_levels < MAX_TIMING_LEVELS) {
+        long latency = strtol(curr, &end, 10);
+        if (end == curr || latency < 0)
+            return false;
+        config->hit_latency[config->num_levels++] = latency;
+        if (*end == '\0')
+            return true;
+        if (*end != ',')
+            return false;
+        curr = end + 1;
+    }
+    return false;
+}
+
+timing_model* build_timing_model(timing_config* config)
+{
+    timing_model* tm = calloc(1, sizeof(timing_model));
+    if (tm == NULL)
+        return NULL;
+    tm->config = *config;
+    return tm;
+}
+
+void destroy_timing_model(timing_model* tm)
+{
+    free(tm);
+}
+
+void timing_access(timing_model* tm, uint64_t block, int level,
+                   int extra_cycles)
+{
+    uint64_t done = 0;
+    bool merged = false;
+
+    retire_mshrs(tm, tm->now);
+    /* join a miss to the same block if there is one, even when the cache
+     * already counts the block as present its data is still arriving */
+    for (int i = 0; i < tm->active_mshrs && ! merged; ++i) {
+        if (tm->mshrs[i].block == block) {
+            done = tm->mshrs[i].done;
+            merged = true;
+            tm->merged += 1;
+        }
+    }
+    if (level < tm->config.num_levels && ! merged) {
+        done = tm->now + tm->config.hit_latency[level];
+    } else if (! merged) {
+        /* stall until an MSHR frees */
+        if (tm->active_mshrs == tm->config.mshrs) {
+            uint64_t first_free = tm->mshrs[0].done;
+            for (int i = 1; i < tm->active_mshrs; ++i) {
+                if (tm->mshrs[i].done < first_free)
+                    first_free = tm->mshrs[i].done;
+            }
+            tm->stall_cycles += first_free - tm->now;
+            tm->now = first_free;
+            retire_mshrs(tm, tm->now);
+        }
+        done = start_miss(tm, block, tm->now);
+    }
+    done += extra_cycles;
+
+    tm->accesses += 1;
+    tm->total_latency += done - tm->now;
+    if (done > tm->end)
+        tm->end = done;
+    tm->now += 1;
+}
+
+uint64_t timing_cycles(timing_model* tm)
+{
+    return tm->end > tm->now ? tm->end : tm->now;
+}
+
+double timing_amat(timing_model* tm)
+{
+    return tm->accesses ? (double) tm->total_latency / tm->accesses : 0;
+}
+
+void print_timing_summary(timing_model* tm)
+{
+    uint64_t cycles = timing_cycles(tm);
+    double amat = timing_amat(tm);
+    double mlp = tm->busy_cycles ? (double) tm->miss_cycles / tm->busy_cycles
+                                 : 0;
+    printf("timing cycles:%" PRIu64 " amat:%.2f mlp:%.2f memory-accesses:%lu"
+           " merged:%lu mshr-stall-cycles:%" PRIu64 "\n", cycles, amat, mlp,
+           tm->misses, tm->merged, tm->stall_cycles);
+}
@@ -0,0 +1,125 @@
+/*
+ * tlb.c
+ * A multi-level TLB built from cache simulators.
+ */
+#include "../include/tlb.h"
+#include "../include/cache_simulator.h"
+#include "../include/dueling.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* The bits translated by each level of an x86-64 page table. */
+#define PAGE_TABLE_BITS 9
+/* The bits of a virtual address covered by the page table. */
+#define VIRTUAL_ADDRESS_BITS 48
+
+/* Return log2 of n if n is a power of two, else -1. */
+static int log2_exact(uint64_t n)
+{
+    int bits = 0;
+    if (n == 0 || (n & (n - 1)) != 0)
+        return -1;
+    while ((1ULL << bits) != n)
+        bits++;
+    return bits;
+}
+
+tlb* build_tlb(tlb_level_config* configs, int num_levels, int page_bits,
+               int walk_latency)
+{
+    tlb* t = calloc(1, sizeof(tlb));
+    if (t == NULL)
+        return NULL;
+    t->page_bits = page_bits;
+    t->walk_latency = walk_latency;
+    /* one page table reference per 9 bits above the page offset */
+    t->walk_levels = (VIRTUAL_ADDRESS_BITS - page_bits + PAGE_TABLE_BITS - 1)
+                     / PAGE_TABLE_BITS;
+    for (int i = 0; i < num_levels; ++i) {
+        int set_bits = log2_exact(configs[i].entries / configs[i].ways);
+        t->levels[i] = build_simulator(page_bits, set_bits, configs[i].ways);
+        if (t->levels[i] == NULL) {
+            destroy_tlb(t);
+            return NULL;
+        }
+        t->num_levels += 1;
+        if (! set_replacement_policy(t->levels[i], configs[i].policy)) {
+            destroy_tlb(t);
+            return NULL;
+        }
+    }
+    return t;
+}
+
+void destroy_tlb(tlb* t)
+{
+    for (int i = 0; i < t->num_levels; ++i)
+        destroy_simulator(t->levels[i]);
+    free(t);
+}
+
+bool parse_tlb_level(const char* spec, tlb_level_config* config)
+{
+    char policy[16] = "lru";
+    int fields = sscanf(spec, "%d:%d:%15s", &config->entries, &config->ways,
+                        policy);
+    if (fields < 2 || config->entries <= 0 || config->ways <= 0
+            || config->entries % config->ways != 0)
+        return false;
+    if (log2_exact(config->entries / config->ways) < 0)
+        return false;
+    /* a TLB has no oracle to consult, nor sets to duel when too small */
+    if (! parse_replacement_policy(policy, &config->policy)
+            || config->policy == REPLACE_OPT)
+        return false;
+    return (config->policy != REPLACE_DIP && config->policy != REPLACE_DRRIP)
+        || config->entries / config->ways >= DUELING_MIN_SETS;
+}
+
+bool parse_page_size(const char* spec, int* page_bits)
+{
+    char* end;
+    uint64_t size = strtoull(spec, &end, 10);
+    switch (*end) {
+        case 'G': case 'g':
+            size <<= 10;
+            /* fall through */
+        case 'M': case 'm':
+            size <<= 10;
+            /* fall through */
+        case 'K': case 'k':
+            size <<= 10;
+            end++;
+            break;
+    }
+    *page_bits = log2_exact(size);
+    return *end == '\0' && *page_bits > 0 && *page_bits < VIRTUAL_ADDRESS_BITS;
+}
+
+int tlb_access(tlb* t, uint64_t address, int inst_no)
+{
+    address_info addr;
+    int level;
+    t->accesses += 1;
+    /* a miss in a level fills it, so the translation moves up */
+    for (level = 0; level < t->num_levels; ++level) {
+        get_address_info(address, &addr, t->levels[level]);
+        if (check_cache(t->levels[level], &addr, inst_no) == CACHE_HIT)
+            return level;
+    }
+    t->walks += 1;
+    return level;
+}
+
+void print_tlb_summary(tlb* t)
+{
+    for (int i = 0; i < t->num_levels; ++i)
+        printf("tlb L%d hits:%d misses:%d\n", i + 1,
+               t->levels[i]->hit_count, t->levels[i]->miss_count);
+    printf("tlb walks:%lu walk-refs:%lu walk-cycles:%lu\n", t->walks,
+           t->walks * t->walk_levels,
+           t->walks * t->walk_levels * t->walk_latency);
+}
@@ -0,0 +1,237 @@
+/*
+ * trace_index.c
+ * Sidecar indexes for seeking in and parallel parsing of text traces.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "../include/trace_index.h"
+#include "../include/instruction_reader.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* A run of records for one parsing thread. */
+typedef struct {
+    trace_index* ti;
+    const char* path;
+    long first, count;
+    instruction* records;
+    bool ok;
+} parse_task;
+
+/* Store the size and modification time of the trace at path. */
+static bool stat_trace(const char* path, trace_index_header* header)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+    header->trace_size = st.st_size;
+    header->trace_mtime = st.st_mtime;
+    return true;
+}
+
+/* Build the name of the sidecar of the trace at path. */
+static char* sidecar_path(const char* path)
+{
+    char* sidecar = malloc(strlen(path) + sizeof(TRACE_INDEX_SUFFIX));
+    if (sidecar != NULL) {
+        strcpy(sidecar, path);
+        strcat(sidecar, TRACE_INDEX_SUFFIX);
+    }
+    return sidecar;
+}
+
+/* Parse the records of one task with its own handle on the trace. */
+static void* parse_run(void* data)
+{
+    parse_task* task = data;
+    FILE* file = fopen(task->path, "r");
+    task->ok = file != NULL
+               && seek_trace_record(task->ti, file, task->first);
+    for (long i = 0; task->ok && i < task->count; ++i)
+        task->ok = read_instruction(file, &task->records[i]);
+    if (file)
+        fclose(file);
+    return NULL;
+}
+
+trace_index* build_trace_index(const char* path, int stride)
+{
+    instruction inst;
+    long capacity = 64;
+    trace_index* ti = calloc(1, sizeof(trace_index));
+    if (ti == NULL || (ti->offsets = malloc(capacity * sizeof(int64_t)))
+                      == NULL) {
+        printf("Unable to allocate memory for trace index -- aborting.\n\n");
+        free(ti);
+        return NULL;
+    }
+    FILE* file = fopen(path, "r");
+    if (! file || ! stat_trace(path, &ti->header)) {
+        printf("ERROR: Failed to open reference file: %s\n", path);
+        if (file)
+            fclose(file);
+        destroy_trace_index(ti);
+        return NULL;
+    }
+    memcpy(ti->header.magic, TRACE_INDEX_MAGIC, sizeof(ti->header.magic));
+    ti->header.version = TRACE_INDEX_VERSION;
+    ti->header.stride = stride;
+
+    for (;;) {
+        long offset = ftell(file);
+        if (! read_instruction(file, &inst))
+            break;
+        if (ti->header.num_records % stride == 0) {
+            if (ti->header.num_chunks == capacity) {
+                int64_t* grown = realloc(ti->offsets,
+                                         2 * capacity * sizeof(int64_t));
+                if (grown == NULL) {
+                    printf("Unable to allocate memory for trace index"
+                           " -- aborting.\n\n");
+                    fclose(file);
+                    destroy_trace_index(ti);
+                    return NULL;
+                }
+                ti->offsets = grown;
+                capacity *= 2;
+            }
+            ti->offsets[ti->header.num_chunks++] = offset;
+        }
+        ti->header.num_records += 1;
+    }
+    fclose(file);
+    return ti;
+}
+
+bool save_trace_index(trace_index* ti, const char* path)
+{
+    char* sidecar = sidecar_path(path);
+    char* temp = sidecar ? malloc(strlen(sidecar) + sizeof(".tmp.XXXXXX"))
+                         : NULL;
+    if (temp == NULL) {
+        free(sidecar);
+        return false;
+    }
+    /* written under a unique name and renamed over the sidecar, so jobs
+     * reading it never see a partly written index */
+    strcpy(temp, sidecar);
+    strcat(temp, ".tmp.XXXXXX");
+    int fd = mkstemp(temp);
+    if (fd >= 0)
+        fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    FILE* file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (! file) {
+        if (fd >= 0) {
+            close(fd);
+            unlink(temp);
+        }
+        free(temp);
+        free(sidecar);
+        return false;
+    }
+    bool written = fwrite(&ti->header, sizeof(ti->header), 1, file) == 1
+        && fwrite(ti->offsets, sizeof(int64_t), ti->header.num_chunks, file)
+           == (size_t) ti->header.num_chunks;
+    written = fclose(file) == 0 && written
+              && rename(temp, sidecar) == 0;
+    if (! written)
+        unlink(temp);
+    free(temp);
+    free(sidecar);
+    return written;
+}
+
+trace_index* load_trace_index(const char* path)
+{
+    trace_index_header current;
+    char* sidecar = sidecar_path(path);
+    if (sidecar == NULL || ! stat_trace(path, &current)) {
+        free(sidecar);
+        return NULL;
+    }
+    FILE* file = fopen(sidecar, "rb");
+    free(sidecar);
+    if (! file)
+        return NULL;
+
+    trace_index* ti = calloc(1, sizeof(trace_index));
+    bool loaded = ti != NULL
+        && fread(&ti->header, sizeof(ti->header), 1, file) == 1
+        && memcmp(ti->header.magic, TRACE_INDEX_MAGIC,
+                  sizeof(ti->header.magic)) == 0
+        && ti->header.version == TRACE_INDEX_VERSION
+        && ti->header.stride > 0
+        && ti->header.trace_size == current.trace_size
+        && ti->header.trace_mtime == current.trace_mtime
+        && (ti->offsets = malloc((ti->header.num_chunks + 1)
+                                 * sizeof(int64_t))) != NULL
+        && fread(ti->offsets, sizeof(int64_t), ti->header.num_chunks, file)
+           == (size_t) ti->header.num_chunks;
+    fclose(file);
+    if (! loaded) {
+        if (ti)
+            destroy_trace_index(ti);
+        return NULL;
+    }
+    return ti;
+}
+
+void destroy_trace_index(trace_index* ti)
+{
+    free(ti->offsets);
+    free(ti);
+}
+
+bool seek_trace_record(trace_index* ti, FILE* file, long record)
+{
+    instruction inst;
+    if (record > ti->header.num_records)
+        return false;
+    if (record == ti->header.num_records)
+        return fseek(file, 0, SEEK_END) == 0;
+    long chunk = record / ti->header.stride;
+    if (fseek(file, ti->offsets[chunk], SEEK_SET) != 0)
+        return false;
+    for (long skip = record % ti->header.stride; skip > 0; --skip) {
+        if (! read_instruction(file, &inst))
+            return false;
+    }
+    return true;
+}
+
+bool parse_trace_parallel(trace_index* ti, const char* path, long first,
+                          long count, instruction* records, int threads)
+{
+    parse_task tasks[MAX_PARSE_THREADS];
+    pthread_t workers[MAX_PARSE_THREADS];
+    bool started[MAX_PARSE_THREADS];
+    bool ok = true;
+    if (threads > MAX_PARSE_THREADS)
+        threads = MAX_PARSE_THREADS;
+    if (threads > count)
+        threads = count > 0 ? count : 1;
+
+    /* give each thread an even share of the records */
+    for (int i = 0; i < threads; ++i) {
+        long begin = count * i / threads, end = count * (i + 1) / threads;
+        tasks[i] = (parse_task) {ti, path, first + begin, end - begin,
+                                 records + begin, false};
+        started[i] = pthread_create(&workers[i], NULL, parse_run,
+                                    &tasks[i]) == 0;
+        if (! started[i])
+            parse_run(&tasks[i]);
+    }
+    for (int i = 0; i < threads; ++i) {
+        if (started[i])
+            pthread_join(workers[i], NULL);
+        ok = ok && tasks[i].ok;
+    }
+    if (! ok)
+        printf("ERROR: Failed to parse reference file: %s\n", path);
+    return ok;
+}
@@ -0,0 +1,82 @@
+/*
+ * trace_mux.c
+ * Round robin interleaving of trace files.
+ */
+#include "../include/trace_mux.h"
+#include "../include/instruction_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+trace_mux* open_trace_mux(char** filenames, int num_files, int quantum)
+{
+    trace_mux* mux = calloc(1, sizeof(trace_mux));
+    if (mux == NULL)
+        return NULL;
+    for (int i = 0; i < num_files; ++i) {
+        mux->quanta[i] = quantum;
+        mux->files[i] = open_trace(filenames[i]);
+        if (! mux->files[i]) {
+            printf("ERROR: Failed to open reference file: %s\n", filenames[i]);
+            close_trace_mux(mux);
+            return NULL;
+        }
+        mux->num_files += 1;
+    }
+    mux->remaining = num_files;
+    return mux;
+}
+
+void close_trace_mux(trace_mux* mux)
+{
+    for (int i = 0; i < mux->num_files; ++i)
+        close_trace(mux->files[i]);
+    free(mux);
+}
+
+int mux_read_instruction(trace_mux* mux, instruction* inst)
+{
+    while (mux->remaining > 0) {
+        /* move to the next live file once this one's turn is over */
+        if (mux->done[mux->current]
+                || mux->served == mux->quanta[mux->current]) {
+            mux->current = (mux->current + 1) % mux->num_files;
+            mux->served = 0;
+            continue;
+        }
+        if (read_instruction(mux->files[mux->current], inst)) {
+            mux->served += 1;
+            if (mux->num_files > 1)
+                inst->stream = mux->current;
+            return 1;
+        }
+        mux->done[mux->current] = true;
+        mux->remaining -= 1;
+    }
+    return 0;
+}
+
+int parse_schedule(const char* spec, int* quanta)
+{
+    const char* curr = spec;
+    char* end;
+    int n = 0;
+    while (n < MAX_TRACES) {
+        long quantum = strtol(curr, &end, 10);
+        if (end == curr || quantum <= 0)
+            return 0;
+        quanta[n++] = quantum;
+        if (*end == '\0')
+            return n;
+        if (*end != ',')
+            return 0;
+        curr = end + 1;
+    }
+    return 0;
+}
+
+void set_mux_schedule(trace_mux* mux, int* quanta, int num_quanta)
+{
+    for (int i = 0; i < num_quanta && i < mux->num_files; ++i)
+        mux->quanta[i] = quanta[i];
+}
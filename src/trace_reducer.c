@@ -0,0 +1,67 @@
+/*
+ * trace_reducer.c
+ * Folding runs of same block accesses.
+ */
+#include "../include/trace_reducer.h"
+#include "../include/instruction_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+/* Returns true if next can be folded into the run started by first. */
+static bool same_run(trace_reducer* tr, instruction* first,
+                     instruction* next)
+{
+    return next->op == first->op && next->stream == first->stream
+        && next->address >> tr->block_bits
+           == first->address >> tr->block_bits;
+}
+
+trace_reducer* build_trace_reducer(FILE* file, int block_bits)
+{
+    trace_reducer* tr = calloc(1, sizeof(trace_reducer));
+    if (tr == NULL)
+        return NULL;
+    tr->file = file;
+    tr->block_bits = block_bits;
+    return tr;
+}
+
+void destroy_trace_reducer(trace_reducer* tr)
+{
+    free(tr);
+}
+
+int reduce_instruction(trace_reducer* tr, instruction* inst)
+{
+    instruction next;
+    if (tr->has_next) {
+        *inst = tr->next;
+        tr->has_next = false;
+    } else if (read_instruction(tr->file, inst)) {
+        tr->records += 1 + inst->repeat;
+    } else {
+        return 0;
+    }
+
+    while (read_instruction(tr->file, &next)) {
+        tr->records += 1 + next.repeat;
+        if (! same_run(tr, inst, &next)) {
+            tr->next = next;
+            tr->has_next = true;
+            break;
+        }
+        /* an already reduced record brings its own run along */
+        inst->repeat += 1 + next.repeat;
+    }
+    tr->reduced += 1;
+    return 1;
+}
+
+void print_reduction_summary(trace_reducer* tr)
+{
+    double ratio = tr->reduced ? (double) tr->records / tr->reduced : 0;
+    printf("reduction records:%lu reduced:%lu ratio:%.2f\n", tr->records,
+           tr->reduced, ratio);
+}
@@ -8,13 +8,22 @@
  * on a 1KB direct mapped cache with a block size of 32 bytes.
  */ 
 #include <stdio.h>
+#include <pthread.h>
+#include <immintrin.h>
 #include "../include/cachelab.h"
 
+/* The number of threads used by the multi-threaded transpose. */
+#define TRANS_THREADS 4
+
+/* Transposes of fewer elements than this are not worth waking threads for. */
+#define TRANS_THREAD_MIN_ELEMS (128 * 128)
 
 int is_transpose(int M, int N, int A[N][M], int B[M][N]);
 void transpose_32(int M, int N, int A[N][M], int B[M][N]);
 void transpose_64(int M, int N, int A[N][M], int B[M][N]);
 void transpose_61(int M, int N, int A[N][M], int B[M][N]);
+void transpose_edges(int M, int N, int A[N][M], int B[M][N],
+                     int row_end, int col_end);
 
 /* 
  * transpose_submit - This is the solution transpose function that you
@@ -40,7 +49,7 @@ void transpose_submit(int M, int N, int A[N][M], int B[M][N])
 void transpose_32(int M, int N, int A[N][M], int B[M][N])
 {
 #define BLOCK_SIZE 8
-    int col, row, i, j, a00, a01, a02, a03, a04, a05, a06, a07;
+    int col = 0, row, i, j, a00, a01, a02, a03, a04, a05, a06, a07;
     for (row = 0; row <= N-BLOCK_SIZE; row += BLOCK_SIZE) {
         for (col = 0; col <= M-BLOCK_SIZE; col += BLOCK_SIZE) {
             for (i = row; i < row + BLOCK_SIZE; i++) {
@@ -98,7 +107,7 @@ void transpose_64(int M, int N, int A[N][M], int B[M][N])
 void transpose_61(int M, int N, int A[N][M], int B[M][N])
 {
 #define BLOCK_SIZE 8
-    int col, row, i, j, a00, a01, a02, a03, a04, a05, a06, a07;
+    int col = 0, row, i, j, a00, a01, a02, a03, a04, a05, a06, a07;
     for (row = 0; row < N-BLOCK_SIZE; row += BLOCK_SIZE) {
         for (col = 0; col < M-BLOCK_SIZE; col += BLOCK_SIZE) {
             for (i = row; i < row + BLOCK_SIZE; i++) {
@@ -183,6 +192,251 @@ void trans(int M, int N, int A[N][M], int B[M][N])
 
 }
 
+/*
+ * transpose_edges - Scalar clean up for the kernels below. Copies every
+ *     element that is not inside the tiled region [0, row_end) x [0, col_end).
+ */
+void transpose_edges(int M, int N, int A[N][M], int B[M][N],
+                     int row_end, int col_end)
+{
+    int i, j;
+    for (i = 0; i < row_end; i++) {
+        for (j = col_end; j < M; j++) {
+            B[j][i] = A[i][j];
+        }
+    }
+    for (i = row_end; i < N; i++) {
+        for (j = 0; j < M; j++) {
+            B[j][i] = A[i][j];
+        }
+    }
+}
+
+/*
+ * transpose_sse - Transposes 4x4 tiles in SSE registers. Each row of a
+ *     tile is a single 128 bit load and each column a single store.
+ */
+char transpose_sse_desc[] = "SSE 4x4 register transpose";
+void transpose_sse(int M, int N, int A[N][M], int B[M][N])
+{
+    int i, j;
+    __m128i r0, r1, r2, r3, t0, t1, t2, t3;
+    for (i = 0; i + 4 <= N; i += 4) {
+        for (j = 0; j + 4 <= M; j += 4) {
+            r0 = _mm_loadu_si128((__m128i*) &A[i][j]);
+            r1 = _mm_loadu_si128((__m128i*) &A[i+1][j]);
+            r2 = _mm_loadu_si128((__m128i*) &A[i+2][j]);
+            r3 = _mm_loadu_si128((__m128i*) &A[i+3][j]);
+
+            t0 = _mm_unpacklo_epi32(r0, r1);
+            t1 = _mm_unpacklo_epi32(r2, r3);
+            t2 = _mm_unpackhi_epi32(r0, r1);
+            t3 = _mm_unpackhi_epi32(r2, r3);
+
+            _mm_storeu_si128((__m128i*) &B[j][i], _mm_unpacklo_epi64(t0, t1));
+            _mm_storeu_si128((__m128i*) &B[j+1][i], _mm_unpackhi_epi64(t0, t1));
+            _mm_storeu_si128((__m128i*) &B[j+2][i], _mm_unpacklo_epi64(t2, t3));
+            _mm_storeu_si128((__m128i*) &B[j+3][i], _mm_unpackhi_epi64(t2, t3));
+        }
+    }
+    transpose_edges(M, N, A, B, N - N % 4, M - M % 4);
+}
+
+/* Transpose the 8x8 tile of A at (row, col) into B using AVX2. */
+__attribute__((target("avx2")))
+static void transpose_tile_avx2(int M, int N, int A[N][M], int B[M][N],
+                                int row, int col)
+{
+    __m256i r0, r1, r2, r3, r4, r5, r6, r7;
+    __m256i t0, t1, t2, t3, t4, t5, t6, t7;
+
+    r0 = _mm256_loadu_si256((__m256i*) &A[row][col]);
+    r1 = _mm256_loadu_si256((__m256i*) &A[row+1][col]);
+    r2 = _mm256_loadu_si256((__m256i*) &A[row+2][col]);
+    r3 = _mm256_loadu_si256((__m256i*) &A[row+3][col]);
+    r4 = _mm256_loadu_si256((__m256i*) &A[row+4][col]);
+    r5 = _mm256_loadu_si256((__m256i*) &A[row+5][col]);
+    r6 = _mm256_loadu_si256((__m256i*) &A[row+6][col]);
+    r7 = _mm256_loadu_si256((__m256i*) &A[row+7][col]);
+
+    /* Interleave pairs of rows. */
+    t0 = _mm256_unpacklo_epi32(r0, r1);
+    t1 = _mm256_unpackhi_epi32(r0, r1);
+    t2 = _mm256_unpacklo_epi32(r2, r3);
+    t3 = _mm256_unpackhi_epi32(r2, r3);
+    t4 = _mm256_unpacklo_epi32(r4, r5);
+    t5 = _mm256_unpackhi_epi32(r4, r5);
+    t6 = _mm256_unpacklo_epi32(r6, r7);
+    t7 = _mm256_unpackhi_epi32(r6, r7);
+
+    /* Each 128 bit lane now holds half of two columns. */
+    r0 = _mm256_unpacklo_epi64(t0, t2);
+    r1 = _mm256_unpackhi_epi64(t0, t2);
+    r2 = _mm256_unpacklo_epi64(t1, t3);
+    r3 = _mm256_unpackhi_epi64(t1, t3);
+    r4 = _mm256_unpacklo_epi64(t4, t6);
+    r5 = _mm256_unpackhi_epi64(t4, t6);
+    r6 = _mm256_unpacklo_epi64(t5, t7);
+    r7 = _mm256_unpackhi_epi64(t5, t7);
+
+    /* Join the lanes of the top and bottom halves of the tile. */
+    _mm256_storeu_si256((__m256i*) &B[col][row],
+                        _mm256_permute2x128_si256(r0, r4, 0x20));
+    _mm256_storeu_si256((__m256i*) &B[col+1][row],
+                        _mm256_permute2x128_si256(r1, r5, 0x20));
+    _mm256_storeu_si256((__m256i*) &B[col+2][row],
+                        _mm256_permute2x128_si256(r2, r6, 0x20));
+    _mm256_storeu_si256((__m256i*) &B[col+3][row],
+                        _mm256_permute2x128_si256(r3, r7, 0x20));
+    _mm256_storeu_si256((__m256i*) &B[col+4][row],
+                        _mm256_permute2x128_si256(r0, r4, 0x31));
+    _mm256_storeu_si256((__m256i*) &B[col+5][row],
+                        _mm256_permute2x128_si256(r1, r5, 0x31));
+    _mm256_storeu_si256((__m256i*) &B[col+6][row],
+                        _mm256_permute2x128_si256(r2, r6, 0x31));
+    _mm256_storeu_si256((__m256i*) &B[col+7][row],
+                        _mm256_permute2x128_si256(r3, r7, 0x31));
+}
+
+/*
+ * transpose_avx2 - Transposes 8x8 tiles in AVX2 registers. Falls back
+ *     to the SSE kernel on machines without AVX2.
+ */
+char transpose_avx2_desc[] = "AVX2 8x8 register transpose";
+void transpose_avx2(int M, int N, int A[N][M], int B[M][N])
+{
+    int i, j;
+    if (! __builtin_cpu_supports("avx2")) {
+        transpose_sse(M, N, A, B);
+        return;
+    }
+    for (i = 0; i + 8 <= N; i += 8) {
+        for (j = 0; j + 8 <= M; j += 8) {
+            transpose_tile_avx2(M, N, A, B, i, j);
+        }
+    }
+    transpose_edges(M, N, A, B, N - N % 8, M - M % 8);
+}
+
+/* The work given to a single thread of transpose_threaded. */
+typedef struct {
+    int M, N;
+    void *A, *B;
+    /* The band of rows of A handled by this thread. */
+    int row_begin, row_end;
+} trans_band;
+
+/* Transpose one band of rows with 8x8 tiles. */
+static void* transpose_band(void* arg)
+{
+    trans_band* band = arg;
+    int M = band->M;
+    int (*A)[M] = band->A;
+    int (*B)[band->N] = band->B;
+    int row, col, i, j;
+    for (row = band->row_begin; row < band->row_end; row += 8) {
+        for (col = 0; col < M; col += 8) {
+            for (i = row; i < row + 8 && i < band->row_end; i++) {
+                for (j = col; j < col + 8 && j < M; j++) {
+                    B[j][i] = A[i][j];
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * The workers of transpose_threaded, started on its first call and kept
+ * for the rest of the run. Each call publishes its bands and bumps the
+ * generation; worker t transposes band t and the caller band 0.
+ */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work, done;
+    unsigned long generation;
+    int workers, pending;
+    trans_band bands[TRANS_THREADS];
+} pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+          PTHREAD_COND_INITIALIZER, 0, 0, 0, {{0}}};
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+/* Wait for each new generation of bands and transpose this worker's. */
+static void* pool_worker(void* arg)
+{
+    trans_band* band = arg;
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.generation == seen)
+            pthread_cond_wait(&pool.work, &pool.lock);
+        seen = pool.generation;
+        pthread_mutex_unlock(&pool.lock);
+        transpose_band(band);
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.pending == 0)
+            pthread_cond_signal(&pool.done);
+    }
+    return NULL;
+}
+
+/* Start the workers; bands without one are run by the caller. */
+static void start_pool(void)
+{
+    int t;
+    for (t = 1; t < TRANS_THREADS; t++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, pool_worker, &pool.bands[t]))
+            break;
+        pthread_detach(thread);
+        pool.workers++;
+    }
+}
+
+/*
+ * transpose_threaded - Splits A into bands of 8-row tiles and transposes
+ *     each band on a thread of a pool kept between calls. Small matrices
+ *     are transposed on the calling thread alone.
+ */
+char transpose_threaded_desc[] = "Multi-threaded 8x8 tiled transpose";
+void transpose_threaded(int M, int N, int A[N][M], int B[M][N])
+{
+    int tiles = (N + 7) / 8;
+    int t, first_tile = 0;
+
+    if (M * N < TRANS_THREAD_MIN_ELEMS) {
+        trans_band whole = {M, N, A, B, 0, N};
+        transpose_band(&whole);
+        return;
+    }
+    pthread_once(&pool_once, start_pool);
+    for (t = 0; t < TRANS_THREADS; t++) {
+        int num_tiles = tiles / TRANS_THREADS + (t < tiles % TRANS_THREADS);
+        pool.bands[t].M = M;
+        pool.bands[t].N = N;
+        pool.bands[t].A = A;
+        pool.bands[t].B = B;
+        pool.bands[t].row_begin = first_tile * 8;
+        first_tile += num_tiles;
+        pool.bands[t].row_end = first_tile * 8 < N ? first_tile * 8 : N;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.pending = pool.workers;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+
+    transpose_band(&pool.bands[0]);
+    for (t = pool.workers + 1; t < TRANS_THREADS; t++)
+        transpose_band(&pool.bands[t]);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.pending > 0)
+        pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
 /*
  * registerFunctions - This function registers your transpose
  *     functions with the driver.  At runtime, the driver will
@@ -197,6 +451,19 @@ void registerFunctions()
 
     /* Register any additional transpose functions */
     registerTransFunction(trans, trans_desc); 
+    registerTransFunction(transpose_sse, transpose_sse_desc);
+    registerTransFunction(transpose_avx2, transpose_avx2_desc);
+}
+
+/*
+ * registerNativeFunctions - Register the transpose functions that are only
+ *     timed natively. Their traces would include the thread library's own
+ *     accesses, so tracegen never sees them and their misses are not
+ *     simulated.
+ */
+void registerNativeFunctions()
+{
+    registerTransFunction(transpose_threaded, transpose_threaded_desc);
 }
 
 /* 
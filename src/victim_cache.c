@@ -0,0 +1,84 @@
+/*
+ * victim_cache.c
+ * Victim cache and miss cache models.
+ */
+#include "../include/victim_cache.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* Put block in the least recently used entry. */
+static void replace_lru(victim_cache* vc, uint64_t block);
+
+victim_cache* build_victim_cache(victim_kind kind, int num_entries)
+{
+    victim_cache* vc = malloc(sizeof(victim_cache));
+    if (vc == NULL)
+        return NULL;
+    vc->blocks = calloc(num_entries, sizeof(uint64_t));
+    vc->last_use = calloc(num_entries, sizeof(unsigned long));
+    if (vc->blocks == NULL || vc->last_use == NULL) {
+        destroy_victim_cache(vc);
+        return NULL;
+    }
+    vc->kind = kind;
+    vc->num_entries = num_entries;
+    vc->now = vc->probes = vc->hits = 0;
+    return vc;
+}
+
+void destroy_victim_cache(victim_cache* vc)
+{
+    free(vc->blocks);
+    free(vc->last_use);
+    free(vc);
+}
+
+bool victim_probe(victim_cache* vc, uint64_t block)
+{
+    vc->now += 1;
+    vc->probes += 1;
+    for (int i = 0; i < vc->num_entries; ++i) {
+        if (vc->blocks[i] == block + 1) {
+            vc->hits += 1;
+            if (vc->kind == VICTIM_CACHE)
+                /* the block moves back into the cache */
+                vc->blocks[i] = 0;
+            else
+                vc->last_use[i] = vc->now;
+            return true;
+        }
+    }
+    if (vc->kind == MISS_CACHE)
+        replace_lru(vc, block);
+    return false;
+}
+
+void victim_insert(victim_cache* vc, uint64_t block)
+{
+    if (vc->kind == VICTIM_CACHE)
+        replace_lru(vc, block);
+}
+
+void print_victim_summary(victim_cache* vc)
+{
+    printf("%s entries:%d hits:%lu misses:%lu\n",
+           vc->kind == VICTIM_CACHE ? "victim-cache" : "miss-cache",
+           vc->num_entries, vc->hits, vc->probes - vc->hits);
+}
+
+static void replace_lru(victim_cache* vc, uint64_t block)
+{
+    int oldest = 0;
+    for (int i = 0; i < vc->num_entries; ++i) {
+        if (vc->blocks[i] == 0) {
+            oldest = i;
+            break;
+        }
+        if (vc->last_use[i] < vc->last_use[oldest])
+            oldest = i;
+    }
+    vc->blocks[oldest] = block + 1;
+    vc->last_use[oldest] = vc->now;
+}